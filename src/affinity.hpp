@@ -0,0 +1,134 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+/*
+ * CPU topology and thread pinning for the throughput benchmark. The
+ * logical CPUs the process may run on are grouped by physical core from
+ * /sys/devices/system/cpu/cpuN/topology. A placement is the order in which
+ * threads take those CPUs: distinct_cores gives every thread its own core
+ * before any core gets a second thread, smt_siblings fills all the hardware
+ * threads of a core before moving to the next one. Outside Linux every
+ * logical CPU counts as its own core and pinning does nothing.
+ */
+
+struct cpu_info
+{
+	size_t cpu;
+	size_t core;
+	size_t package;
+};
+
+enum class thread_placement
+{
+	distinct_cores,
+	smt_siblings,
+};
+
+inline const char* thread_placement_name(thread_placement placement)
+{
+	switch (placement)
+	{
+	case thread_placement::smt_siblings:
+		return "SMT siblings";
+	default:
+		return "distinct cores";
+	}
+}
+
+#if defined(__linux__)
+inline size_t read_topology(size_t cpu, const char* name, size_t fallback)
+{
+	char path[128];
+	snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%zu/topology/%s", cpu, name);
+	FILE* f = fopen(path, "r");
+	if (!f) return fallback;
+	size_t value = fallback;
+	if (fscanf(f, "%zu", &value) != 1) value = fallback;
+	fclose(f);
+	return value;
+}
+#endif
+
+// the logical CPUs of this process, sorted by package, core and CPU number
+inline std::vector<cpu_info> available_cpus()
+{
+	std::vector<cpu_info> cpus;
+#if defined(__linux__)
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	if (sched_getaffinity(0, sizeof(set), &set) == 0)
+	{
+		for (size_t cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+		{
+			if (CPU_ISSET(cpu, &set)) cpus.push_back({ cpu, read_topology(cpu, "core_id", cpu), read_topology(cpu, "physical_package_id", 0) });
+		}
+	}
+#endif
+	if (cpus.empty())
+	{
+		for (size_t cpu = 0; cpu < std::max((size_t)std::thread::hardware_concurrency(), (size_t)1); ++cpu) cpus.push_back({ cpu, cpu, 0 });
+	}
+	std::sort(cpus.begin(), cpus.end(), [](const cpu_info& a, const cpu_info& b)
+	{
+		return a.package != b.package ? a.package < b.package : a.core != b.core ? a.core < b.core : a.cpu < b.cpu;
+	});
+	return cpus;
+}
+
+inline size_t physical_cores(const std::vector<cpu_info>& cpus)
+{
+	size_t count = 0;
+	for (size_t i = 0; i < cpus.size(); ++i) count += i == 0 || cpus[i].core != cpus[i - 1].core || cpus[i].package != cpus[i - 1].package;
+	return count;
+}
+
+// logical CPU for every thread number under placement
+inline std::vector<size_t> placement_order(const std::vector<cpu_info>& cpus, thread_placement placement)
+{
+	std::vector<size_t> order;
+	if (placement == thread_placement::smt_siblings)
+	{
+		for (const cpu_info& c : cpus) order.push_back(c.cpu);
+		return order;
+	}
+
+	// first CPU of every core, then the second ones, ...
+	std::vector<size_t> sibling(cpus.size());
+	for (size_t i = 1; i < cpus.size(); ++i)
+	{
+		const bool same_core = cpus[i].core == cpus[i - 1].core && cpus[i].package == cpus[i - 1].package;
+		sibling[i] = same_core ? sibling[i - 1] + 1 : 0;
+	}
+	for (size_t s = 0; order.size() < cpus.size(); ++s)
+	{
+		for (size_t i = 0; i < cpus.size(); ++i)
+		{
+			if (sibling[i] == s) order.push_back(cpus[i].cpu);
+		}
+	}
+	return order;
+}
+
+// pins the calling thread to one logical CPU, false if that is not possible
+inline bool pin_current_thread(size_t cpu)
+{
+#if defined(__linux__)
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+	(void)cpu;
+	return false;
+#endif
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+
+#include "page_alloc.hpp"
+
+/*
+ * Owning, cache-line-aligned byte buffer for searchers that keep their own
+ * copy of a layout. The type is erased so one searcher object can hold keys
+ * of any type. The memory is mapped with default_page_kind(), so page
+ * mappings are at least 64-byte aligned.
+ */
+class aligned_buffer
+{
+public:
+	static constexpr size_t alignment = 64;
+
+	aligned_buffer() = default;
+
+	aligned_buffer(aligned_buffer&& o) noexcept
+		: ptr{ o.ptr }, bytes{ o.bytes }, kind{ o.kind }
+	{
+		o.ptr = nullptr;
+		o.bytes = 0;
+	}
+
+	aligned_buffer& operator=(aligned_buffer&& o) noexcept
+	{
+		std::swap(ptr, o.ptr);
+		std::swap(bytes, o.bytes);
+		std::swap(kind, o.kind);
+		return *this;
+	}
+
+	aligned_buffer(const aligned_buffer&) = delete;
+	aligned_buffer& operator=(const aligned_buffer&) = delete;
+
+	~aligned_buffer()
+	{
+		page_free(ptr, bytes, kind);
+	}
+
+	// drops the previous contents
+	void* allocate(size_t _bytes, page_kind _kind = default_page_kind())
+	{
+		// emptied first, so a failed allocation does not leave a freed pointer behind
+		page_free(std::exchange(ptr, nullptr), std::exchange(bytes, 0), kind);
+		ptr = page_alloc(_bytes, _kind);
+		bytes = _bytes;
+		kind = _kind;
+		return ptr;
+	}
+
+	template<class Ty>
+	Ty* data() { return (Ty*)ptr; }
+
+	template<class Ty>
+	const Ty* data() const { return (const Ty*)ptr; }
+
+	size_t size() const { return bytes; }
+
+private:
+	void* ptr = nullptr;
+	size_t bytes = 0;
+	page_kind kind = page_kind::small;
+};
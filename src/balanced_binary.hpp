@@ -93,6 +93,13 @@ bool balanced_binary_search_sse2(const IntTy* keys, size_t size, IntTy target, s
 			ptarget
 		));
 		break;
+	case 8:
+		ptarget = _mm_set1_epi64x((int64_t)target);
+		mask = _mm_movemask_epi8(cmpeq_epi64_sse(
+			_mm_loadu_si128((const __m128i*)&keys[left1]),
+			ptarget
+		));
+		break;
 	}
 
 	size_t i = count_trailing_zeroes(mask);
@@ -105,9 +112,9 @@ bool balanced_binary_search_sse2(const IntTy* keys, size_t size, IntTy target, s
 }
 #endif
 
-#ifdef __AVX2__
+#ifdef AVX2_KERNELS_AVAILABLE
 template<bool use_prefetch, class IntTy>
-bool balanced_binary_search_avx2(const IntTy* keys, size_t size, IntTy target, size_t& ret)
+TARGET_AVX2 bool balanced_binary_search_avx2(const IntTy* keys, size_t size, IntTy target, size_t& ret)
 {
 	static constexpr size_t cacheLineSize = 64 / sizeof(IntTy);
 	static constexpr int minH = get_bit_size(32 / sizeof(IntTy));
@@ -156,6 +163,13 @@ bool balanced_binary_search_avx2(const IntTy* keys, size_t size, IntTy target, s
 			ptarget
 		));
 		break;
+	case 8:
+		ptarget = _mm256_set1_epi64x((int64_t)target);
+		mask = _mm256_movemask_epi8(_mm256_cmpeq_epi64(
+			_mm256_loadu_si256((const __m256i*)&keys[left1]),
+			ptarget
+		));
+		break;
 	}
 
 	size_t i = count_trailing_zeroes(mask);
@@ -0,0 +1,239 @@
+#pragma once
+
+#include <type_traits>
+
+#include "balanced_binary.hpp"
+#include "bst.hpp"
+
+template<class IntTy, class ValueTy>
+void balanced_binary_search_batch(const IntTy* keys, const ValueTy* values, size_t size, const IntTy* targets, size_t n_targets, ValueTy* out, uint8_t* found)
+{
+	for (size_t j = 0; j < n_targets; ++j)
+	{
+		size_t idx;
+		found[j] = balanced_binary_search<false>(keys, size, targets[j], idx);
+		if (found[j]) out[j] = values[idx];
+	}
+}
+
+template<size_t n, class IntTy, class ValueTy>
+void nst_search_batch(const IntTy* keys, const ValueTy* values, size_t size, const IntTy* targets, size_t n_targets, ValueTy* out, uint8_t* found)
+{
+	for (size_t j = 0; j < n_targets; ++j)
+	{
+		size_t idx;
+		found[j] = nst_search<n>(keys, size, targets[j], idx);
+		if (found[j]) out[j] = values[idx];
+	}
+}
+
+#ifdef __AVX2__
+#include <immintrin.h>
+
+/*
+ * Vertical search: every lane of a 256-bit register carries its own query,
+ * so one gather fetches the next node of 8 different lookups at once.
+ * Lanes hold 32-bit indices, int16 keys are sign-extended into 32-bit lanes
+ * and processed as two registers (16 queries) in lockstep.
+ */
+
+template<class IntTy>
+using IsGatherKey = std::integral_constant<bool, std::is_same<IntTy, int32_t>::value || std::is_same<IntTy, int16_t>::value>;
+
+inline __m256i load_targets_avx2(const int32_t* targets)
+{
+	return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(targets));
+}
+
+inline __m256i load_targets_avx2(const int16_t* targets)
+{
+	return _mm256_cvtepi16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(targets)));
+}
+
+inline __m256i gather_avx2(const int32_t* keys, __m256i idx, __m256i mask)
+{
+	return _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), reinterpret_cast<const int*>(keys), idx, mask, 4);
+}
+
+/*
+ * int16 keys are gathered as the 32 bits ending at keys[idx], from
+ * keys[idx - 1], keeping the upper half, so the last key does not read
+ * past the array. A lane with idx 0 reads keys[0..1] and keeps the lower
+ * half instead, which needs at least 2 keys.
+ */
+inline __m256i gather_int16_avx2(__m256i g, __m256i pback)
+{
+	return _mm256_srai_epi32(_mm256_sllv_epi32(g, _mm256_andnot_si256(pback, _mm256_set1_epi32(16))), 16);
+}
+
+inline __m256i gather_avx2(const int16_t* keys, __m256i idx, __m256i mask)
+{
+	const __m256i pback = _mm256_cmpgt_epi32(idx, _mm256_setzero_si256());
+	__m256i g = _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), reinterpret_cast<const int*>(keys), _mm256_add_epi32(idx, pback), mask, 2);
+	return gather_int16_avx2(g, pback);
+}
+
+inline __m256i gather_avx2(const int32_t* keys, __m256i idx)
+{
+	return _mm256_i32gather_epi32(reinterpret_cast<const int*>(keys), idx, 4);
+}
+
+inline __m256i gather_avx2(const int16_t* keys, __m256i idx)
+{
+	const __m256i pback = _mm256_cmpgt_epi32(idx, _mm256_setzero_si256());
+	__m256i g = _mm256_i32gather_epi32(reinterpret_cast<const int*>(keys), _mm256_add_epi32(idx, pback), 2);
+	return gather_int16_avx2(g, pback);
+}
+
+template<class ValueTy>
+inline void scatter_found_avx2(__m256i pidx, __m256i pfound, const ValueTy* values, ValueTy* out, uint8_t* found)
+{
+	alignas(32) uint32_t idx[8];
+	_mm256_store_si256(reinterpret_cast<__m256i*>(idx), pidx);
+	uint32_t m = _mm256_movemask_ps(_mm256_castsi256_ps(pfound));
+	for (size_t k = 0; k < 8; ++k)
+	{
+		found[k] = (m >> k) & 1;
+		if (found[k]) out[k] = values[idx[k]];
+	}
+}
+
+template<size_t groups, class IntTy, class ValueTy>
+void balanced_binary_search_block_avx2(const IntTy* keys, const ValueTy* values, size_t size, const IntTy* targets, ValueTy* out, uint8_t* found)
+{
+	__m256i ptarget[groups], pleft1[groups], pleft2[groups], pmid[groups];
+	const __m256i pone = _mm256_set1_epi32(1);
+
+	int height = ceil_log2(size + 1);
+	size_t dist = (size_t)1 << (size_t)(height - 1);
+	size_t mid = size - dist;
+	dist >>= 1;
+	for (size_t g = 0; g < groups; ++g)
+	{
+		ptarget[g] = load_targets_avx2(targets + g * 8);
+		pleft1[g] = _mm256_setzero_si256();
+		pleft2[g] = _mm256_set1_epi32((int32_t)(mid + 1));
+		pmid[g] = _mm256_set1_epi32((int32_t)mid);
+	}
+
+	while (height-- > 0)
+	{
+		__m256i pdist = _mm256_set1_epi32((int32_t)dist);
+		for (size_t g = 0; g < groups; ++g)
+		{
+			__m256i pgt = _mm256_cmpgt_epi32(ptarget[g], gather_avx2(keys, pmid[g]));
+			pleft1[g] = _mm256_blendv_epi8(pleft1[g], pleft2[g], pgt);
+			pleft2[g] = _mm256_add_epi32(pleft1[g], pdist);
+			pmid[g] = _mm256_sub_epi32(pleft2[g], pone);
+		}
+		dist >>= 1;
+	}
+
+	const __m256i psize = _mm256_set1_epi32((int32_t)size);
+	for (size_t g = 0; g < groups; ++g)
+	{
+		__m256i pvalid = _mm256_cmpgt_epi32(psize, pleft1[g]);
+		__m256i peq = _mm256_and_si256(_mm256_cmpeq_epi32(ptarget[g], gather_avx2(keys, pleft1[g], pvalid)), pvalid);
+		scatter_found_avx2(pleft1[g], peq, values, out + g * 8, found + g * 8);
+	}
+}
+
+template<class IntTy, class ValueTy>
+typename std::enable_if<!IsGatherKey<IntTy>::value>::type balanced_binary_search_batch_avx2(const IntTy* keys, const ValueTy* values, size_t size, const IntTy* targets, size_t n_targets, ValueTy* out, uint8_t* found)
+{
+	balanced_binary_search_batch(keys, values, size, targets, n_targets, out, found);
+}
+
+template<class IntTy, class ValueTy>
+typename std::enable_if<IsGatherKey<IntTy>::value>::type balanced_binary_search_batch_avx2(const IntTy* keys, const ValueTy* values, size_t size, const IntTy* targets, size_t n_targets, ValueTy* out, uint8_t* found)
+{
+	static constexpr size_t groups = 4 / sizeof(IntTy);
+	static constexpr size_t block_size = 8 * groups;
+
+	size_t j = 0;
+	// indices have to fit in the signed 32-bit lanes, int16 gathers need 2 keys
+	if (size >= 2 && size < ((size_t)1 << 31))
+	{
+		for (; j + block_size <= n_targets; j += block_size)
+		{
+			balanced_binary_search_block_avx2<groups>(keys, values, size, targets + j, out + j, found + j);
+		}
+	}
+	balanced_binary_search_batch(keys, values, size, targets + j, n_targets - j, out + j, found + j);
+}
+
+template<size_t n, size_t groups, class IntTy, class ValueTy>
+void nst_search_block_avx2(const IntTy* keys, const ValueTy* values, size_t size, const IntTy* targets, ValueTy* out, uint8_t* found)
+{
+	__m256i ptarget[groups], pi[groups], pret[groups], pfound[groups], pactive[groups];
+	const __m256i psize = _mm256_set1_epi32((int32_t)size);
+	const __m256i pn = _mm256_set1_epi32((int32_t)n);
+	const __m256i pn1 = _mm256_set1_epi32((int32_t)(n - 1));
+	const __m256i pone = _mm256_set1_epi32(1);
+
+	for (size_t g = 0; g < groups; ++g)
+	{
+		ptarget[g] = load_targets_avx2(targets + g * 8);
+		pi[g] = _mm256_setzero_si256();
+		pret[g] = _mm256_setzero_si256();
+		pfound[g] = _mm256_setzero_si256();
+		pactive[g] = _mm256_cmpgt_epi32(psize, pi[g]);
+	}
+
+	bool running = true;
+	while (running)
+	{
+		running = false;
+		for (size_t g = 0; g < groups; ++g)
+		{
+			if (_mm256_testz_si256(pactive[g], pactive[g])) continue;
+
+			__m256i pr = _mm256_setzero_si256();
+			for (size_t k = 0; k < n - 1; ++k)
+			{
+				__m256i pk = _mm256_add_epi32(pi[g], _mm256_set1_epi32((int32_t)k));
+				__m256i pm = _mm256_and_si256(pactive[g], _mm256_cmpgt_epi32(psize, pk));
+				__m256i pkey = gather_avx2(keys, pk, pm);
+				__m256i peq = _mm256_and_si256(_mm256_cmpeq_epi32(ptarget[g], pkey), pm);
+				pr = _mm256_sub_epi32(pr, _mm256_and_si256(_mm256_cmpgt_epi32(ptarget[g], pkey), pm));
+				pret[g] = _mm256_blendv_epi8(pret[g], pk, peq);
+				pfound[g] = _mm256_or_si256(pfound[g], peq);
+			}
+
+			// i = i * n + (n - 1) * (r + 1)
+			pi[g] = _mm256_add_epi32(_mm256_mullo_epi32(pi[g], pn), _mm256_mullo_epi32(_mm256_add_epi32(pr, pone), pn1));
+			pactive[g] = _mm256_andnot_si256(pfound[g], _mm256_and_si256(pactive[g], _mm256_cmpgt_epi32(psize, pi[g])));
+			running = true;
+		}
+	}
+
+	for (size_t g = 0; g < groups; ++g)
+	{
+		scatter_found_avx2(pret[g], pfound[g], values, out + g * 8, found + g * 8);
+	}
+}
+
+template<size_t n, class IntTy, class ValueTy>
+typename std::enable_if<!IsGatherKey<IntTy>::value>::type nst_search_batch_avx2(const IntTy* keys, const ValueTy* values, size_t size, const IntTy* targets, size_t n_targets, ValueTy* out, uint8_t* found)
+{
+	nst_search_batch<n>(keys, values, size, targets, n_targets, out, found);
+}
+
+template<size_t n, class IntTy, class ValueTy>
+typename std::enable_if<IsGatherKey<IntTy>::value>::type nst_search_batch_avx2(const IntTy* keys, const ValueTy* values, size_t size, const IntTy* targets, size_t n_targets, ValueTy* out, uint8_t* found)
+{
+	static constexpr size_t groups = 4 / sizeof(IntTy);
+	static constexpr size_t block_size = 8 * groups;
+
+	size_t j = 0;
+	// the child index i * n + n * (n - 1) must not overflow the signed 32-bit lanes, int16 gathers need 2 keys
+	if (size >= 2 && size < (((size_t)1 << 31) - n * n) / n)
+	{
+		for (; j + block_size <= n_targets; j += block_size)
+		{
+			nst_search_block_avx2<n, groups>(keys, values, size, targets + j, out + j, found + j);
+		}
+	}
+	nst_search_batch<n>(keys, values, size, targets + j, n_targets - j, out + j, found + j);
+}
+#endif
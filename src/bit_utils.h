@@ -15,6 +15,50 @@
 #include <immintrin.h>
 #endif
 
+/*
+ * The AVX2 kernels are compiled into every x86-64 build. Without -mavx2 they
+ * get a target attribute instead, so a portable binary can still pick them at
+ * runtime (see dispatch.hpp).
+ */
+#if defined(__AVX2__)
+#define AVX2_KERNELS_AVAILABLE
+#define TARGET_AVX2
+#elif defined(__GNUC__) && defined(__x86_64__)
+#define AVX2_KERNELS_AVAILABLE
+#define TARGET_AVX2 __attribute__((target("avx2,popcnt")))
+#elif defined(_MSC_VER) && defined(_M_X64)
+#define AVX2_KERNELS_AVAILABLE
+#define TARGET_AVX2
+#endif
+
+#if defined(__SSE2__) || defined(__AVX2__)
+// 64-bit lane compares, emulated with 32-bit ones below SSE4.1/SSE4.2
+inline __m128i cmpeq_epi64_sse(__m128i a, __m128i b)
+{
+#if defined(__SSE4_1__)
+	return _mm_cmpeq_epi64(a, b);
+#else
+	__m128i eq = _mm_cmpeq_epi32(a, b);
+	return _mm_and_si128(eq, _mm_shuffle_epi32(eq, _MM_SHUFFLE(2, 3, 0, 1)));
+#endif
+}
+
+inline __m128i cmpgt_epi64_sse(__m128i a, __m128i b)
+{
+#if defined(__SSE4_2__)
+	return _mm_cmpgt_epi64(a, b);
+#else
+	// signed compare of the high halves, unsigned compare of the low halves
+	const __m128i sign = _mm_set1_epi32((int32_t)0x80000000);
+	__m128i hi_gt = _mm_cmpgt_epi32(a, b);
+	__m128i hi_eq = _mm_cmpeq_epi32(a, b);
+	__m128i lo_gt = _mm_cmpgt_epi32(_mm_xor_si128(a, sign), _mm_xor_si128(b, sign));
+	__m128i gt = _mm_or_si128(hi_gt, _mm_and_si128(hi_eq, _mm_shuffle_epi32(lo_gt, _MM_SHUFFLE(2, 2, 0, 0))));
+	return _mm_shuffle_epi32(gt, _MM_SHUFFLE(3, 3, 1, 1));
+#endif
+}
+#endif
+
 inline int count_trailing_zeroes(uint32_t v)
 {
 	if (v == 0)
@@ -3,19 +3,15 @@
 #include <vector>
 #include <algorithm>
 #include <numeric>
+#include <limits>
 
 #include "bit_utils.h"
+#include "radix_sort.hpp"
 
 template<class KeyTy>
 std::vector<size_t> bst_order(const KeyTy* keys, size_t size)
 {
-	std::vector<size_t> ret(size), idx(size);
-	std::iota(idx.begin(), idx.end(), 0);
-
-	std::sort(idx.begin(), idx.end(), [&](size_t a, size_t b)
-	{
-		return keys[a] < keys[b];
-	});
+	std::vector<size_t> ret(size), idx = sorted_index(keys, size);
 
 	size_t height = 0;
 	for (size_t s = size; s > 0; s >>= 1) height++;
@@ -78,13 +74,7 @@ Ty powi(Ty a, size_t b)
 template<size_t n, class KeyTy>
 std::vector<size_t> nst_order(const KeyTy* keys, size_t size)
 {
-	std::vector<size_t> ret(size), idx(size);
-	std::iota(idx.begin(), idx.end(), 0);
-
-	std::sort(idx.begin(), idx.end(), [&](size_t a, size_t b)
-	{
-		return keys[a] < keys[b];
-	});
+	std::vector<size_t> ret(size), idx = sorted_index(keys, size);
 
 	size_t height = 0;
 	for (size_t s = size; s > 0; s /= n) height++;
@@ -137,6 +127,151 @@ bool nst_search(const KeyTy* keys, size_t size, KeyTy target, size_t& ret)
 	return false;
 }
 
+/*
+ * Padded storage for the SIMD kernels: the nst_order layout followed by
+ * copies of the largest key value until the last node is full. Every node then
+ * holds n - 1 keys, so nst_search_padded_* need neither a bound check per key
+ * nor a tail path. The sentinels can only match a target equal to the largest
+ * value, so callers reject a position >= the real size.
+ */
+template<size_t n>
+size_t nst_padded_size(size_t size)
+{
+	return (size + n - 2) / (n - 1) * (n - 1);
+}
+
+template<size_t n, class KeyTy>
+void nst_pad(const KeyTy* keys, size_t size, KeyTy* padded)
+{
+	std::copy(keys, keys + size, padded);
+	std::fill(padded + size, padded + nst_padded_size<n>(size), std::numeric_limits<KeyTy>::max());
+}
+
+/*
+ * Ordered queries on the nst_order / bst_order layouts. They return the layout
+ * position of the key they select, or size if there is none:
+ *   lower: the first key >= target
+ *   upper: the first key > target
+ *   predecessor: the last key <= target
+ * nst_rank converts a layout position into its index in sorted order, so the
+ * position returned on a miss becomes the insertion point of the target.
+ */
+enum class bound_kind
+{
+	lower,
+	upper,
+	predecessor,
+};
+
+// r is the number of keys in the node that precede the bound, cand is updated to the best key seen so far
+template<bound_kind kind>
+inline void update_bound(size_t i, size_t r, size_t ke, size_t& cand)
+{
+	if (kind == bound_kind::predecessor)
+	{
+		if (r > 0) cand = i + r - 1;
+	}
+	else if (r < ke)
+	{
+		cand = i + r;
+	}
+}
+
+template<size_t n, bound_kind kind, class KeyTy>
+inline size_t nst_bound_step(const KeyTy* keys, size_t size, KeyTy target, size_t i, size_t& cand)
+{
+	size_t r = 0;
+	size_t ke = std::min(n - 1, size - i);
+	for (size_t k = 0; k < ke; ++k)
+	{
+		if (kind == bound_kind::lower) r += keys[i + k] < target;
+		else r += !(target < keys[i + k]);
+	}
+	update_bound<kind>(i, r, ke, cand);
+	return i * n + (n - 1) * (r + 1);
+}
+
+template<size_t n, bound_kind kind, class KeyTy>
+size_t nst_bound(const KeyTy* keys, size_t size, KeyTy target)
+{
+	size_t i = 0, cand = size;
+	while (i < size)
+	{
+		i = nst_bound_step<n, kind>(keys, size, target, i, cand);
+	}
+	return cand;
+}
+
+template<size_t n, class KeyTy>
+size_t nst_lower_bound(const KeyTy* keys, size_t size, KeyTy target)
+{
+	return nst_bound<n, bound_kind::lower>(keys, size, target);
+}
+
+template<size_t n, class KeyTy>
+size_t nst_upper_bound(const KeyTy* keys, size_t size, KeyTy target)
+{
+	return nst_bound<n, bound_kind::upper>(keys, size, target);
+}
+
+template<size_t n, class KeyTy>
+size_t nst_predecessor(const KeyTy* keys, size_t size, KeyTy target)
+{
+	return nst_bound<n, bound_kind::predecessor>(keys, size, target);
+}
+
+// bst_order is the 2-ary case of nst_order
+template<class KeyTy>
+size_t bst_lower_bound(const KeyTy* keys, size_t size, KeyTy target)
+{
+	return nst_bound<2, bound_kind::lower>(keys, size, target);
+}
+
+template<class KeyTy>
+size_t bst_upper_bound(const KeyTy* keys, size_t size, KeyTy target)
+{
+	return nst_bound<2, bound_kind::upper>(keys, size, target);
+}
+
+template<class KeyTy>
+size_t bst_predecessor(const KeyTy* keys, size_t size, KeyTy target)
+{
+	return nst_bound<2, bound_kind::predecessor>(keys, size, target);
+}
+
+// index in sorted order of the key at layout position pos, the inverse of nst_order
+template<size_t n>
+size_t nst_rank(size_t pos, size_t size)
+{
+	if (pos >= size) return size;
+
+	size_t height = 0;
+	for (size_t s = size; s > 0; s /= n) height++;
+
+	size_t complete_size = powi(n, height) - 1;
+	size_t off = complete_size - size;
+	size_t off_start = complete_size + 1 - ((off + n - 2) / (n - 1) + off);
+
+	size_t h = 0, level_start = 0, level_size = n - 1;
+	while (pos >= level_start + level_size)
+	{
+		level_start += level_size;
+		level_size *= n;
+		++h;
+	}
+
+	size_t j = pos - level_start;
+	size_t stride = powi(n, height - h - 1);
+	size_t f = stride - 1 + ((j / (n - 1)) * n + j % (n - 1)) * stride;
+	if (f > off_start) f -= (f - off_start) - (f - off_start) / n;
+	return f;
+}
+
+inline size_t bst_rank(size_t pos, size_t size)
+{
+	return nst_rank<2>(pos, size);
+}
+
 constexpr inline size_t clog2(size_t n)
 {
 	return n == 2 ? 1 : (n <= 1 ? 0 : (clog2((n + 1) / 2) + 1));
@@ -212,7 +347,7 @@ inline bool test_eq(__m128i p, size_t offset, size_t size, size_t& ret)
 }
 
 template<size_t n, class IntTy>
-typename std::enable_if < (n - 1) < 16 / sizeof(IntTy), bool > ::type nst_search_sse2(const IntTy* keys, size_t size, IntTy target, size_t& ret)
+typename std::enable_if<((n - 1) < 16 / sizeof(IntTy) || (n - 1) > 64 / sizeof(IntTy)), bool>::type nst_search_sse2(const IntTy* keys, size_t size, IntTy target, size_t& ret)
 {
 	return nst_search<n>(keys, size, target, ret);
 }
@@ -234,6 +369,9 @@ CondBool<n, IntTy, 16> nst_search_sse2(const IntTy* keys, size_t size, IntTy tar
 	case 4:
 		ptarget = _mm_set1_epi32(target);
 		break;
+	case 8:
+		ptarget = _mm_set1_epi64x(target);
+		break;
 	}
 
 	while (i < size)
@@ -253,6 +391,10 @@ CondBool<n, IntTy, 16> nst_search_sse2(const IntTy* keys, size_t size, IntTy tar
 			peq = _mm_cmpeq_epi32(ptarget, pkey);
 			pgt = _mm_cmpgt_epi32(ptarget, pkey);
 			break;
+		case 8:
+			peq = cmpeq_epi64_sse(ptarget, pkey);
+			pgt = cmpgt_epi64_sse(ptarget, pkey);
+			break;
 		}
 
 		if (test_eq<IntTy>(peq, i, size, ret)) return true;
@@ -282,6 +424,9 @@ CondBool<n, IntTy, 32> nst_search_sse2(const IntTy* keys, size_t size, IntTy tar
 	case 4:
 		ptarget = _mm_set1_epi32(target);
 		break;
+	case 8:
+		ptarget = _mm_set1_epi64x(target);
+		break;
 	}
 
 	while (i < size)
@@ -308,6 +453,12 @@ CondBool<n, IntTy, 32> nst_search_sse2(const IntTy* keys, size_t size, IntTy tar
 			peq[1] = _mm_cmpeq_epi32(ptarget, pkey[1]);
 			pgt[1] = _mm_cmpgt_epi32(ptarget, pkey[1]);
 			break;
+		case 8:
+			peq[0] = cmpeq_epi64_sse(ptarget, pkey[0]);
+			pgt[0] = cmpgt_epi64_sse(ptarget, pkey[0]);
+			peq[1] = cmpeq_epi64_sse(ptarget, pkey[1]);
+			pgt[1] = cmpgt_epi64_sse(ptarget, pkey[1]);
+			break;
 		}
 
 		if (test_eq<IntTy>(peq[0], i + 0 * packet_size, size, ret)) return true;
@@ -338,6 +489,9 @@ CondBool<n, IntTy, 64> nst_search_sse2(const IntTy* keys, size_t size, IntTy tar
 	case 4:
 		ptarget = _mm_set1_epi32(target);
 		break;
+	case 8:
+		ptarget = _mm_set1_epi64x(target);
+		break;
 	}
 
 	while (i < size)
@@ -378,6 +532,16 @@ CondBool<n, IntTy, 64> nst_search_sse2(const IntTy* keys, size_t size, IntTy tar
 			peq[3] = _mm_cmpeq_epi32(ptarget, pkey[3]);
 			pgt[3] = _mm_cmpgt_epi32(ptarget, pkey[3]);
 			break;
+		case 8:
+			peq[0] = cmpeq_epi64_sse(ptarget, pkey[0]);
+			pgt[0] = cmpgt_epi64_sse(ptarget, pkey[0]);
+			peq[1] = cmpeq_epi64_sse(ptarget, pkey[1]);
+			pgt[1] = cmpgt_epi64_sse(ptarget, pkey[1]);
+			peq[2] = cmpeq_epi64_sse(ptarget, pkey[2]);
+			pgt[2] = cmpgt_epi64_sse(ptarget, pkey[2]);
+			peq[3] = cmpeq_epi64_sse(ptarget, pkey[3]);
+			pgt[3] = cmpgt_epi64_sse(ptarget, pkey[3]);
+			break;
 		}
 
 		if (test_eq<IntTy>(peq[0], i + 0 * packet_size, size, ret)) return true;
@@ -394,7 +558,7 @@ CondBool<n, IntTy, 64> nst_search_sse2(const IntTy* keys, size_t size, IntTy tar
 }
 
 template<size_t n, class IntTy>
-typename std::enable_if < (n - 1) < 16 / sizeof(IntTy), bool > ::type nst2_search_sse2(const IntTy* keys, size_t size, IntTy target, size_t& ret)
+typename std::enable_if<((n - 1) < 16 / sizeof(IntTy) || (n - 1) > 64 / sizeof(IntTy)), bool>::type nst2_search_sse2(const IntTy* keys, size_t size, IntTy target, size_t& ret)
 {
 	return nst_search<n>(keys, size, target, ret);
 }
@@ -416,6 +580,9 @@ CondBool<n, IntTy, 16> nst2_search_sse2(const IntTy* keys, size_t size, IntTy ta
 	case 4:
 		ptarget = _mm_set1_epi32(target);
 		break;
+	case 8:
+		ptarget = _mm_set1_epi64x(target);
+		break;
 	}
 
 	while (i + 16 / sizeof(IntTy) < size)
@@ -432,6 +599,9 @@ CondBool<n, IntTy, 16> nst2_search_sse2(const IntTy* keys, size_t size, IntTy ta
 		case 4:
 			pgt = _mm_cmpgt_epi32(ptarget, pkey);
 			break;
+		case 8:
+			pgt = cmpgt_epi64_sse(ptarget, pkey);
+			break;
 		}
 
 		size_t r = popcount(_mm_movemask_epi8(pgt)) / sizeof(IntTy);
@@ -458,6 +628,9 @@ CondBool<n, IntTy, 16> nst2_search_sse2(const IntTy* keys, size_t size, IntTy ta
 		case 4:
 			pgt = _mm_cmpeq_epi32(ptarget, pkey);
 			break;
+		case 8:
+			pgt = cmpeq_epi64_sse(ptarget, pkey);
+			break;
 		}
 
 		if (test_eq<IntTy>(pgt, i, size, ret)) return true;
@@ -484,6 +657,9 @@ CondBool<n, IntTy, 32> nst2_search_sse2(const IntTy* keys, size_t size, IntTy ta
 	case 4:
 		ptarget = _mm_set1_epi32(target);
 		break;
+	case 8:
+		ptarget = _mm_set1_epi64x(target);
+		break;
 	}
 
 	while (i + 32 / sizeof(IntTy) < size)
@@ -504,6 +680,10 @@ CondBool<n, IntTy, 32> nst2_search_sse2(const IntTy* keys, size_t size, IntTy ta
 			pgt[0] = _mm_cmpgt_epi32(ptarget, pkey[0]);
 			pgt[1] = _mm_cmpgt_epi32(ptarget, pkey[1]);
 			break;
+		case 8:
+			pgt[0] = cmpgt_epi64_sse(ptarget, pkey[0]);
+			pgt[1] = cmpgt_epi64_sse(ptarget, pkey[1]);
+			break;
 		}
 
 		size_t r = (popcount(_mm_movemask_epi8(pgt[0])) + popcount(_mm_movemask_epi8(pgt[1]))) / sizeof(IntTy);
@@ -534,6 +714,10 @@ CondBool<n, IntTy, 32> nst2_search_sse2(const IntTy* keys, size_t size, IntTy ta
 			pgt[0] = _mm_cmpeq_epi32(ptarget, pkey[0]);
 			pgt[1] = _mm_cmpeq_epi32(ptarget, pkey[1]);
 			break;
+		case 8:
+			pgt[0] = cmpeq_epi64_sse(ptarget, pkey[0]);
+			pgt[1] = cmpeq_epi64_sse(ptarget, pkey[1]);
+			break;
 		}
 
 		if (test_eq<IntTy>(pgt[0], i + 0 * packet_size, size, ret)) return true;
@@ -561,6 +745,9 @@ CondBool<n, IntTy, 64> nst2_search_sse2(const IntTy* keys, size_t size, IntTy ta
 	case 4:
 		ptarget = _mm_set1_epi32(target);
 		break;
+	case 8:
+		ptarget = _mm_set1_epi64x(target);
+		break;
 	}
 
 	while (i + 64 / sizeof(IntTy) < size)
@@ -589,6 +776,12 @@ CondBool<n, IntTy, 64> nst2_search_sse2(const IntTy* keys, size_t size, IntTy ta
 			pgt[2] = _mm_cmpgt_epi32(ptarget, pkey[2]);
 			pgt[3] = _mm_cmpgt_epi32(ptarget, pkey[3]);
 			break;
+		case 8:
+			pgt[0] = cmpgt_epi64_sse(ptarget, pkey[0]);
+			pgt[1] = cmpgt_epi64_sse(ptarget, pkey[1]);
+			pgt[2] = cmpgt_epi64_sse(ptarget, pkey[2]);
+			pgt[3] = cmpgt_epi64_sse(ptarget, pkey[3]);
+			break;
 		}
 
 		size_t r = (popcount(_mm_movemask_epi8(pgt[0])) + popcount(_mm_movemask_epi8(pgt[1]))
@@ -629,6 +822,12 @@ CondBool<n, IntTy, 64> nst2_search_sse2(const IntTy* keys, size_t size, IntTy ta
 			pgt[2] = _mm_cmpeq_epi32(ptarget, pkey[2]);
 			pgt[3] = _mm_cmpeq_epi32(ptarget, pkey[3]);
 			break;
+		case 8:
+			pgt[0] = cmpeq_epi64_sse(ptarget, pkey[0]);
+			pgt[1] = cmpeq_epi64_sse(ptarget, pkey[1]);
+			pgt[2] = cmpeq_epi64_sse(ptarget, pkey[2]);
+			pgt[3] = cmpeq_epi64_sse(ptarget, pkey[3]);
+			break;
 		}
 
 		if (test_eq<IntTy>(pgt[0], i + 0 * packet_size, size, ret)) return true;
@@ -638,13 +837,135 @@ CondBool<n, IntTy, 64> nst2_search_sse2(const IntTy* keys, size_t size, IntTy ta
 	}
 	return false;
 }
+
+template<class IntTy>
+inline __m128i set1_sse2(IntTy v)
+{
+	switch (sizeof(IntTy))
+	{
+	case 1:
+		return _mm_set1_epi8(v);
+	case 2:
+		return _mm_set1_epi16(v);
+	case 4:
+		return _mm_set1_epi32(v);
+	case 8:
+		return _mm_set1_epi64x(v);
+	}
+	return _mm_setzero_si128();
+}
+
+template<class IntTy>
+inline __m128i cmpgt_sse2(__m128i a, __m128i b)
+{
+	switch (sizeof(IntTy))
+	{
+	case 1:
+		return _mm_cmpgt_epi8(a, b);
+	case 2:
+		return _mm_cmpgt_epi16(a, b);
+	case 4:
+		return _mm_cmpgt_epi32(a, b);
+	case 8:
+		return cmpgt_epi64_sse(a, b);
+	}
+	return _mm_setzero_si128();
+}
+
+template<size_t n, class IntTy, size_t p>
+using IsPacketNode = std::integral_constant<bool, (n - 1) >= p / sizeof(IntTy) && (n - 1) % (p / sizeof(IntTy)) == 0 && (n - 1) <= 64 / sizeof(IntTy)>;
+
+template<size_t n, bound_kind kind, class IntTy>
+typename std::enable_if<!IsPacketNode<n, IntTy, 16>::value, size_t>::type nst_bound_sse2(const IntTy* keys, size_t size, IntTy target)
+{
+	return nst_bound<n, kind>(keys, size, target);
+}
+
+template<size_t n, bound_kind kind, class IntTy>
+typename std::enable_if<IsPacketNode<n, IntTy, 16>::value, size_t>::type nst_bound_sse2(const IntTy* keys, size_t size, IntTy target)
+{
+	static constexpr size_t packet_size = 16 / sizeof(IntTy);
+
+	const __m128i ptarget = set1_sse2(target);
+	size_t i = 0, cand = size;
+	while (i + n - 1 <= size)
+	{
+		size_t c = 0;
+		for (size_t p = 0; p < (n - 1) / packet_size; ++p)
+		{
+			__m128i pkey = _mm_loadu_si128((const __m128i*)&keys[i + p * packet_size]);
+			// lower counts the keys below target, the others count the keys above it
+			c += popcount(_mm_movemask_epi8(kind == bound_kind::lower
+				? cmpgt_sse2<IntTy>(ptarget, pkey) : cmpgt_sse2<IntTy>(pkey, ptarget)));
+		}
+		size_t r = c / sizeof(IntTy);
+		if (kind != bound_kind::lower) r = n - 1 - r;
+		update_bound<kind>(i, r, n - 1, cand);
+		i = i * n + (n - 1) * (r + 1);
+	}
+
+	// only the last node of the layout can be partial
+	if (i < size) nst_bound_step<n, kind>(keys, size, target, i, cand);
+	return cand;
+}
+
+template<size_t n, class IntTy>
+size_t nst_lower_bound_sse2(const IntTy* keys, size_t size, IntTy target)
+{
+	return nst_bound_sse2<n, bound_kind::lower>(keys, size, target);
+}
+
+template<size_t n, class IntTy>
+size_t nst_upper_bound_sse2(const IntTy* keys, size_t size, IntTy target)
+{
+	return nst_bound_sse2<n, bound_kind::upper>(keys, size, target);
+}
+
+template<size_t n, class IntTy>
+size_t nst_predecessor_sse2(const IntTy* keys, size_t size, IntTy target)
+{
+	return nst_bound_sse2<n, bound_kind::predecessor>(keys, size, target);
+}
+
+template<size_t n, class IntTy>
+typename std::enable_if<!IsPacketNode<n, IntTy, 16>::value, bool>::type nst_search_padded_sse2(const IntTy* keys, size_t size, IntTy target, size_t& ret)
+{
+	return nst_search<n>(keys, size, target, ret);
+}
+
+// keys must be 16-byte aligned and size a multiple of n - 1, see nst_pad
+template<size_t n, class IntTy>
+typename std::enable_if<IsPacketNode<n, IntTy, 16>::value, bool>::type nst_search_padded_sse2(const IntTy* keys, size_t size, IntTy target, size_t& ret)
+{
+	static constexpr size_t packet_size = 16 / sizeof(IntTy);
+
+	const __m128i ptarget = set1_sse2(target);
+	size_t i = 0;
+	while (i < size)
+	{
+		size_t c = 0;
+		for (size_t p = 0; p < (n - 1) / packet_size; ++p)
+		{
+			__m128i pkey = _mm_load_si128((const __m128i*)&keys[i + p * packet_size]);
+			c += popcount(_mm_movemask_epi8(cmpgt_sse2<IntTy>(ptarget, pkey)));
+		}
+		size_t r = c / sizeof(IntTy);
+		if (r < n - 1 && keys[i + r] == target)
+		{
+			ret = i + r;
+			return true;
+		}
+		i = i * n + (n - 1) * (r + 1);
+	}
+	return false;
+}
 #endif
 
-#ifdef __AVX2__
+#ifdef AVX2_KERNELS_AVAILABLE
 #include <immintrin.h>
 
 template<class IntTy>
-inline bool test_eq(__m256i p, size_t offset, size_t size, size_t& ret)
+TARGET_AVX2 inline bool test_eq(__m256i p, size_t offset, size_t size, size_t& ret)
 {
 	uint32_t m = _mm256_movemask_epi8(p);
 	uint32_t b = count_trailing_zeroes(m);
@@ -656,14 +977,65 @@ inline bool test_eq(__m256i p, size_t offset, size_t size, size_t& ret)
 	return false;
 }
 
+template<class IntTy>
+TARGET_AVX2 inline __m256i set1_avx2(IntTy v)
+{
+	switch (sizeof(IntTy))
+	{
+	case 1:
+		return _mm256_set1_epi8(v);
+	case 2:
+		return _mm256_set1_epi16(v);
+	case 4:
+		return _mm256_set1_epi32(v);
+	case 8:
+		return _mm256_set1_epi64x(v);
+	}
+	return _mm256_setzero_si256();
+}
+
+template<class IntTy>
+TARGET_AVX2 inline __m256i cmpeq_avx2(__m256i a, __m256i b)
+{
+	switch (sizeof(IntTy))
+	{
+	case 1:
+		return _mm256_cmpeq_epi8(a, b);
+	case 2:
+		return _mm256_cmpeq_epi16(a, b);
+	case 4:
+		return _mm256_cmpeq_epi32(a, b);
+	case 8:
+		return _mm256_cmpeq_epi64(a, b);
+	}
+	return _mm256_setzero_si256();
+}
+
+template<class IntTy>
+TARGET_AVX2 inline __m256i cmpgt_avx2(__m256i a, __m256i b)
+{
+	switch (sizeof(IntTy))
+	{
+	case 1:
+		return _mm256_cmpgt_epi8(a, b);
+	case 2:
+		return _mm256_cmpgt_epi16(a, b);
+	case 4:
+		return _mm256_cmpgt_epi32(a, b);
+	case 8:
+		return _mm256_cmpgt_epi64(a, b);
+	}
+	return _mm256_setzero_si256();
+}
+
 template<size_t n, class IntTy>
-typename std::enable_if < (n - 1) < 32 / sizeof(IntTy), bool > ::type nst_search_avx2(const IntTy* keys, size_t size, IntTy target, size_t& ret)
+typename std::enable_if<((n - 1) < 32 / sizeof(IntTy) || (n - 1) > 64 / sizeof(IntTy)), bool>::type nst_search_avx2(const IntTy* keys, size_t size, IntTy target, size_t& ret)
 {
 	return nst_search<n>(keys, size, target, ret);
 }
 
 template<size_t n, class IntTy>
-CondBool<n, IntTy, 32> nst_search_avx2(const IntTy* keys, size_t size, IntTy target, size_t& ret)
+TARGET_AVX2 CondBool<n, IntTy, 32> nst_search_avx2(const IntTy* keys, size_t size, IntTy target, size_t& ret)
 {
 	size_t i = 0;
 
@@ -679,6 +1051,9 @@ CondBool<n, IntTy, 32> nst_search_avx2(const IntTy* keys, size_t size, IntTy tar
 	case 4:
 		ptarget = _mm256_set1_epi32(target);
 		break;
+	case 8:
+		ptarget = _mm256_set1_epi64x(target);
+		break;
 	}
 
 	while (i < size)
@@ -698,6 +1073,10 @@ CondBool<n, IntTy, 32> nst_search_avx2(const IntTy* keys, size_t size, IntTy tar
 			peq = _mm256_cmpeq_epi32(ptarget, pkey);
 			pgt = _mm256_cmpgt_epi32(ptarget, pkey);
 			break;
+		case 8:
+			peq = _mm256_cmpeq_epi64(ptarget, pkey);
+			pgt = _mm256_cmpgt_epi64(ptarget, pkey);
+			break;
 		}
 
 		if (test_eq<IntTy>(peq, i, size, ret)) return true;
@@ -709,7 +1088,7 @@ CondBool<n, IntTy, 32> nst_search_avx2(const IntTy* keys, size_t size, IntTy tar
 }
 
 template<size_t n, class IntTy>
-CondBool<n, IntTy, 64> nst_search_avx2(const IntTy* keys, size_t size, IntTy target, size_t& ret)
+TARGET_AVX2 CondBool<n, IntTy, 64> nst_search_avx2(const IntTy* keys, size_t size, IntTy target, size_t& ret)
 {
 	static constexpr size_t packet_size = 32 / sizeof(IntTy);
 	static constexpr size_t inner_size = (n - 1) / packet_size;
@@ -728,6 +1107,9 @@ CondBool<n, IntTy, 64> nst_search_avx2(const IntTy* keys, size_t size, IntTy tar
 	case 4:
 		ptarget = _mm256_set1_epi32(target);
 		break;
+	case 8:
+		ptarget = _mm256_set1_epi64x(target);
+		break;
 	}
 
 	while (i < size)
@@ -754,6 +1136,12 @@ CondBool<n, IntTy, 64> nst_search_avx2(const IntTy* keys, size_t size, IntTy tar
 			peq[1] = _mm256_cmpeq_epi32(ptarget, pkey[1]);
 			pgt[1] = _mm256_cmpgt_epi32(ptarget, pkey[1]);
 			break;
+		case 8:
+			peq[0] = _mm256_cmpeq_epi64(ptarget, pkey[0]);
+			pgt[0] = _mm256_cmpgt_epi64(ptarget, pkey[0]);
+			peq[1] = _mm256_cmpeq_epi64(ptarget, pkey[1]);
+			pgt[1] = _mm256_cmpgt_epi64(ptarget, pkey[1]);
+			break;
 		}
 
 		if (test_eq<IntTy>(peq[0], i + 0 * packet_size, size, ret)) return true;
@@ -766,13 +1154,13 @@ CondBool<n, IntTy, 64> nst_search_avx2(const IntTy* keys, size_t size, IntTy tar
 }
 
 template<size_t n, class IntTy>
-typename std::enable_if < (n - 1) < 32 / sizeof(IntTy), bool > ::type nst2_search_avx2(const IntTy* keys, size_t size, IntTy target, size_t& ret)
+typename std::enable_if<((n - 1) < 32 / sizeof(IntTy) || (n - 1) > 64 / sizeof(IntTy)), bool>::type nst2_search_avx2(const IntTy* keys, size_t size, IntTy target, size_t& ret)
 {
 	return nst_search<n>(keys, size, target, ret);
 }
 
 template<size_t n, class IntTy>
-CondBool<n, IntTy, 32> nst2_search_avx2(const IntTy* keys, size_t size, IntTy target, size_t& ret)
+TARGET_AVX2 CondBool<n, IntTy, 32> nst2_search_avx2(const IntTy* keys, size_t size, IntTy target, size_t& ret)
 {
 	size_t i = 0;
 
@@ -788,6 +1176,9 @@ CondBool<n, IntTy, 32> nst2_search_avx2(const IntTy* keys, size_t size, IntTy ta
 	case 4:
 		ptarget = _mm256_set1_epi32(target);
 		break;
+	case 8:
+		ptarget = _mm256_set1_epi64x(target);
+		break;
 	}
 
 	while (i + 32 / sizeof(IntTy) < size)
@@ -804,6 +1195,9 @@ CondBool<n, IntTy, 32> nst2_search_avx2(const IntTy* keys, size_t size, IntTy ta
 		case 4:
 			pgt = _mm256_cmpgt_epi32(ptarget, pkey);
 			break;
+		case 8:
+			pgt = _mm256_cmpgt_epi64(ptarget, pkey);
+			break;
 		}
 
 		size_t r = popcount(_mm256_movemask_epi8(pgt)) / sizeof(IntTy);
@@ -830,6 +1224,9 @@ CondBool<n, IntTy, 32> nst2_search_avx2(const IntTy* keys, size_t size, IntTy ta
 		case 4:
 			pgt = _mm256_cmpeq_epi32(ptarget, pkey);
 			break;
+		case 8:
+			pgt = _mm256_cmpeq_epi64(ptarget, pkey);
+			break;
 		}
 
 		if (test_eq<IntTy>(pgt, i, size, ret)) return true;
@@ -838,7 +1235,7 @@ CondBool<n, IntTy, 32> nst2_search_avx2(const IntTy* keys, size_t size, IntTy ta
 }
 
 template<size_t n, class IntTy>
-CondBool<n, IntTy, 64> nst2_search_avx2(const IntTy* keys, size_t size, IntTy target, size_t& ret)
+TARGET_AVX2 CondBool<n, IntTy, 64> nst2_search_avx2(const IntTy* keys, size_t size, IntTy target, size_t& ret)
 {
 	static constexpr size_t packet_size = 32 / sizeof(IntTy);
 	static constexpr size_t inner_size = (n - 1) / packet_size;
@@ -857,6 +1254,9 @@ CondBool<n, IntTy, 64> nst2_search_avx2(const IntTy* keys, size_t size, IntTy ta
 	case 4:
 		ptarget = _mm256_set1_epi32(target);
 		break;
+	case 8:
+		ptarget = _mm256_set1_epi64x(target);
+		break;
 	}
 
 	while (i + 64 / sizeof(IntTy) < size)
@@ -877,6 +1277,10 @@ CondBool<n, IntTy, 64> nst2_search_avx2(const IntTy* keys, size_t size, IntTy ta
 			pgt[0] = _mm256_cmpgt_epi32(ptarget, pkey[0]);
 			pgt[1] = _mm256_cmpgt_epi32(ptarget, pkey[1]);
 			break;
+		case 8:
+			pgt[0] = _mm256_cmpgt_epi64(ptarget, pkey[0]);
+			pgt[1] = _mm256_cmpgt_epi64(ptarget, pkey[1]);
+			break;
 		}
 
 		size_t r = (popcount(_mm256_movemask_epi8(pgt[0])) + popcount(_mm256_movemask_epi8(pgt[1]))) / sizeof(IntTy);
@@ -907,6 +1311,10 @@ CondBool<n, IntTy, 64> nst2_search_avx2(const IntTy* keys, size_t size, IntTy ta
 			pgt[0] = _mm256_cmpeq_epi32(ptarget, pkey[0]);
 			pgt[1] = _mm256_cmpeq_epi32(ptarget, pkey[1]);
 			break;
+		case 8:
+			pgt[0] = _mm256_cmpeq_epi64(ptarget, pkey[0]);
+			pgt[1] = _mm256_cmpeq_epi64(ptarget, pkey[1]);
+			break;
 		}
 
 		if (test_eq<IntTy>(pgt[0], i + 0 * packet_size, size, ret)) return true;
@@ -914,6 +1322,89 @@ CondBool<n, IntTy, 64> nst2_search_avx2(const IntTy* keys, size_t size, IntTy ta
 	}
 	return false;
 }
+
+template<size_t n, bound_kind kind, class IntTy>
+typename std::enable_if<!IsPacketNode<n, IntTy, 32>::value, size_t>::type nst_bound_avx2(const IntTy* keys, size_t size, IntTy target)
+{
+	return nst_bound<n, kind>(keys, size, target);
+}
+
+template<size_t n, bound_kind kind, class IntTy>
+TARGET_AVX2 typename std::enable_if<IsPacketNode<n, IntTy, 32>::value, size_t>::type nst_bound_avx2(const IntTy* keys, size_t size, IntTy target)
+{
+	static constexpr size_t packet_size = 32 / sizeof(IntTy);
+
+	const __m256i ptarget = set1_avx2(target);
+	size_t i = 0, cand = size;
+	while (i + n - 1 <= size)
+	{
+		size_t c = 0;
+		for (size_t p = 0; p < (n - 1) / packet_size; ++p)
+		{
+			__m256i pkey = _mm256_loadu_si256((const __m256i*)&keys[i + p * packet_size]);
+			c += popcount(_mm256_movemask_epi8(kind == bound_kind::lower
+				? cmpgt_avx2<IntTy>(ptarget, pkey) : cmpgt_avx2<IntTy>(pkey, ptarget)));
+		}
+		size_t r = c / sizeof(IntTy);
+		if (kind != bound_kind::lower) r = n - 1 - r;
+		update_bound<kind>(i, r, n - 1, cand);
+		i = i * n + (n - 1) * (r + 1);
+	}
+
+	if (i < size) nst_bound_step<n, kind>(keys, size, target, i, cand);
+	return cand;
+}
+
+template<size_t n, class IntTy>
+size_t nst_lower_bound_avx2(const IntTy* keys, size_t size, IntTy target)
+{
+	return nst_bound_avx2<n, bound_kind::lower>(keys, size, target);
+}
+
+template<size_t n, class IntTy>
+size_t nst_upper_bound_avx2(const IntTy* keys, size_t size, IntTy target)
+{
+	return nst_bound_avx2<n, bound_kind::upper>(keys, size, target);
+}
+
+template<size_t n, class IntTy>
+size_t nst_predecessor_avx2(const IntTy* keys, size_t size, IntTy target)
+{
+	return nst_bound_avx2<n, bound_kind::predecessor>(keys, size, target);
+}
+
+template<size_t n, class IntTy>
+typename std::enable_if<!IsPacketNode<n, IntTy, 32>::value, bool>::type nst_search_padded_avx2(const IntTy* keys, size_t size, IntTy target, size_t& ret)
+{
+	return nst_search<n>(keys, size, target, ret);
+}
+
+// keys must be 32-byte aligned and size a multiple of n - 1, see nst_pad
+template<size_t n, class IntTy>
+TARGET_AVX2 typename std::enable_if<IsPacketNode<n, IntTy, 32>::value, bool>::type nst_search_padded_avx2(const IntTy* keys, size_t size, IntTy target, size_t& ret)
+{
+	static constexpr size_t packet_size = 32 / sizeof(IntTy);
+
+	const __m256i ptarget = set1_avx2(target);
+	size_t i = 0;
+	while (i < size)
+	{
+		size_t c = 0;
+		for (size_t p = 0; p < (n - 1) / packet_size; ++p)
+		{
+			__m256i pkey = _mm256_load_si256((const __m256i*)&keys[i + p * packet_size]);
+			c += popcount(_mm256_movemask_epi8(cmpgt_avx2<IntTy>(ptarget, pkey)));
+		}
+		size_t r = c / sizeof(IntTy);
+		if (r < n - 1 && keys[i + r] == target)
+		{
+			ret = i + r;
+			return true;
+		}
+		i = i * n + (n - 1) * (r + 1);
+	}
+	return false;
+}
 #endif
 
 #if defined(__ARM_NEON__) || defined(__ARM_NEON)
@@ -934,6 +1425,11 @@ inline uint32_t pop_unit_count(uint32x4_t val) {
 	return vaddvq_u32(vandq_u32(val, mask));
 }
 
+inline uint32_t pop_unit_count(uint64x2_t val) {
+	const uint64x2_t mask = { 1, 1 };
+	return (uint32_t)vaddvq_u64(vandq_u64(val, mask));
+}
+
 inline bool neon_lookup(int8x16_t pkeys, int8x16_t ptarget, size_t size, size_t& ret)
 {
 	size_t found;
@@ -1019,6 +1515,27 @@ inline bool neon_lookup(int32x4_t pkeys, int32x4_t ptarget, size_t size, size_t&
 	return false;
 }
 
+inline bool neon_lookup(int64x2_t pkeys, int64x2_t ptarget, size_t size, size_t& ret)
+{
+	size_t found;
+	static const uint64_t __attribute__((aligned(16))) idx[2][2] = {
+		{ 1, 2 },
+		{ 1, 0 },
+	};
+	uint64x2_t selected = vandq_u64(vceqq_s64(
+		pkeys,
+		ptarget
+	), vld1q_u64(idx[2 - std::min(size, (size_t)2)]));
+	found = vaddvq_u64(selected);
+
+	if (found && found - 1 < size)
+	{
+		ret = found - 1;
+		return true;
+	}
+	return false;
+}
+
 template<size_t n>
 bool nst_search_neon(const int8_t* keys, size_t size, int8_t target, size_t& ret)
 {
@@ -1097,6 +1614,32 @@ bool nst_search_neon(const int32_t* keys, size_t size, int32_t target, size_t& r
 	return false;
 }
 
+template<size_t n>
+bool nst_search_neon(const int64_t* keys, size_t size, int64_t target, size_t& ret)
+{
+	size_t i = 0;
+
+	int64x2_t ptarget, pkey;
+	uint64x2_t pgt;
+	ptarget = vdupq_n_s64(target);
+
+	while (i < size)
+	{
+		pkey = vld1q_s64(&keys[i]);
+		pgt = vcgtq_s64(ptarget, pkey);
+
+		if (neon_lookup(pkey, ptarget, size - i, ret))
+		{
+			ret += i;
+			return true;
+		}
+
+		size_t r = pop_unit_count(pgt);
+		i = i * n + (n - 1) * (r + 1);
+	}
+	return false;
+}
+
 template<size_t n>
 bool nst2_search_neon(const int8_t* keys, size_t size, int8_t target, size_t& ret)
 {
@@ -1208,4 +1751,41 @@ bool nst2_search_neon(const int32_t* keys, size_t size, int32_t target, size_t&
 	return false;
 }
 
+template<size_t n>
+bool nst2_search_neon(const int64_t* keys, size_t size, int64_t target, size_t& ret)
+{
+	size_t i = 0;
+
+	int64x2_t ptarget, pkey;
+	uint64x2_t pgt;
+	ptarget = vdupq_n_s64(target);
+
+	while (i + 2 < size)
+	{
+		pkey = vld1q_s64(&keys[i]);
+		pgt = vcgtq_s64(ptarget, pkey);
+
+		size_t r = pop_unit_count(pgt);
+		if (keys[i + r] == target)
+		{
+			ret = i + r;
+			return true;
+		}
+
+		i = i * n + (n - 1) * (r + 1);
+	}
+
+	if (i < size)
+	{
+		pkey = vld1q_s64(&keys[i]);
+
+		if (neon_lookup(pkey, ptarget, size - i, ret))
+		{
+			ret += i;
+			return true;
+		}
+	}
+	return false;
+}
+
 #endif
@@ -0,0 +1,250 @@
+#pragma once
+
+#include <cstdint>
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "dispatch.hpp"
+#include "nst_build.hpp"
+#include "nst_merge.hpp"
+#include "page_alloc.hpp"
+
+/*
+ * Updatable wrapper around an nst_order<n> layout. The layout stays
+ * build-once; updates go to a delta in front of it: a sorted insert buffer
+ * whose entries replace the layout's, and a sorted set of tombstones for the
+ * keys of the layout that are erased or replaced. Both are plain sorted
+ * arrays searched with the scalar balanced binary search, since the SIMD
+ * kernels read a vector past the end of an unpadded array, and a lookup
+ * asks the buffer, then the tombstones, then the layout. An 8 KiB bit filter
+ * over the hashed keys of the delta lets most lookups skip both searches,
+ * so a few thousand pending updates cost one L1 load per lookup.
+ * Once the delta holds buffer_limit entries it is frozen and a background
+ * thread merges it into a new layout with nst_rebuild, while a fresh
+ * delta takes further updates in front of the frozen one.
+ * The owner swaps the new layout in at its next update or poll(). Lookups
+ * and updates come from the owning thread, the background thread only reads
+ * the layout and the frozen delta, so none of them needs a lock.
+ */
+template<class KeyTy, class ValueTy>
+struct nst_delta
+{
+	static constexpr size_t filter_log2 = 16;
+	static constexpr size_t filter_words = ((size_t)1 << filter_log2) / 64;
+
+	std::vector<KeyTy> keys;
+	std::vector<ValueTy> values;
+	std::vector<KeyTy> tombstones;
+	// bit slot(key) is set for every key that entered the delta since the last clear()
+	std::vector<uint64_t> filter = std::vector<uint64_t>(filter_words);
+
+	enum class lookup_result
+	{
+		below,
+		found,
+		erased,
+	};
+
+	size_t size() const { return keys.size() + tombstones.size(); }
+
+	static size_t slot(KeyTy key)
+	{
+		return (size_t)(((uint64_t)key * 0x9e3779b97f4a7c15ull) >> (64 - filter_log2));
+	}
+
+	void mark(KeyTy key)
+	{
+		filter[slot(key) / 64] |= (uint64_t)1 << (slot(key) % 64);
+	}
+
+	bool maybe_contains(KeyTy key) const
+	{
+		return (filter[slot(key) / 64] >> (slot(key) % 64)) & 1;
+	}
+
+	lookup_result lookup(KeyTy target, ValueTy& found) const
+	{
+		if (!maybe_contains(target)) return lookup_result::below;
+		size_t idx;
+		if (!keys.empty() && balanced_binary_search<false>(keys.data(), keys.size(), target, idx))
+		{
+			found = values[idx];
+			return lookup_result::found;
+		}
+		if (!tombstones.empty() && balanced_binary_search<false>(tombstones.data(), tombstones.size(), target, idx)) return lookup_result::erased;
+		return lookup_result::below;
+	}
+
+	void insert(KeyTy key, ValueTy value)
+	{
+		mark(key);
+		const size_t i = std::lower_bound(keys.begin(), keys.end(), key) - keys.begin();
+		if (i < keys.size() && keys[i] == key)
+		{
+			values[i] = value;
+			return;
+		}
+		keys.insert(keys.begin() + i, key);
+		values.insert(values.begin() + i, value);
+	}
+
+	// true if key was in the buffer
+	bool erase_buffered(KeyTy key)
+	{
+		const size_t i = std::lower_bound(keys.begin(), keys.end(), key) - keys.begin();
+		if (i == keys.size() || keys[i] != key) return false;
+		keys.erase(keys.begin() + i);
+		values.erase(values.begin() + i);
+		return true;
+	}
+
+	void add_tombstone(KeyTy key)
+	{
+		mark(key);
+		auto it = std::lower_bound(tombstones.begin(), tombstones.end(), key);
+		if (it == tombstones.end() || *it != key) tombstones.insert(it, key);
+	}
+
+	void clear()
+	{
+		keys.clear();
+		values.clear();
+		tombstones.clear();
+		std::fill(filter.begin(), filter.end(), 0);
+	}
+};
+
+template<size_t n, class KeyTy, class ValueTy>
+class buffered_nst
+{
+public:
+	using delta_type = nst_delta<KeyTy, ValueTy>;
+
+	explicit buffered_nst(size_t _buffer_limit = 4096)
+		: buffer_limit{ _buffer_limit }
+	{
+	}
+
+	buffered_nst(const buffered_nst&) = delete;
+	buffered_nst& operator=(const buffered_nst&) = delete;
+
+	~buffered_nst()
+	{
+		if (rebuild_thread.joinable()) rebuild_thread.join();
+	}
+
+	// keys must be sorted and unique, drops the delta
+	void build(const KeyTy* keys, const ValueTy* values, size_t size)
+	{
+		wait();
+		active.clear();
+		main_keys.resize(size);
+		main_values.resize(size);
+		nst_build_sorted<n>(keys, values, size, main_keys.data(), main_values.data());
+	}
+
+	bool search(KeyTy target, ValueTy& found) const
+	{
+		if (active.size())
+		{
+			const auto r = active.lookup(target, found);
+			if (r != delta_type::lookup_result::below) return r == delta_type::lookup_result::found;
+		}
+		return search_below(target, found);
+	}
+
+	void insert(KeyTy key, ValueTy value)
+	{
+		active.insert(key, value);
+		maintain();
+	}
+
+	// true if key was present
+	bool erase(KeyTy key)
+	{
+		ValueTy found;
+		if (!search(key, found)) return false;
+		active.erase_buffered(key);
+		if (search_below(key, found)) active.add_tombstone(key);
+		maintain();
+		return true;
+	}
+
+	// swaps in a finished rebuild
+	void poll()
+	{
+		if (rebuilding && rebuilt.load(std::memory_order_acquire)) finish_rebuild();
+	}
+
+	// waits for a running rebuild and swaps it in
+	void wait()
+	{
+		if (rebuilding) finish_rebuild();
+	}
+
+	size_t layout_size() const { return main_keys.size(); }
+	size_t delta_size() const { return active.size() + frozen.size(); }
+	bool is_rebuilding() const { return rebuilding; }
+
+private:
+	size_t buffer_limit;
+	// page-aligned, so the nodes of the layout do not straddle cache lines
+	page_vector<KeyTy> main_keys;
+	page_vector<ValueTy> main_values;
+	delta_type active;
+	delta_type frozen;
+
+	// owned by the background thread while rebuilding
+	page_vector<KeyTy> next_keys;
+	page_vector<ValueTy> next_values;
+	std::thread rebuild_thread;
+	std::atomic<bool> rebuilt{ false };
+	bool rebuilding = false;
+
+	// the frozen delta and the layout
+	bool search_below(KeyTy target, ValueTy& found) const
+	{
+		if (rebuilding && frozen.size())
+		{
+			const auto r = frozen.lookup(target, found);
+			if (r != delta_type::lookup_result::below) return r == delta_type::lookup_result::found;
+		}
+		size_t idx;
+		if (main_keys.empty() || !nst_search_dispatched<n, KeyTy>(main_keys.data(), main_keys.size(), target, idx)) return false;
+		found = main_values[idx];
+		return true;
+	}
+
+	void maintain()
+	{
+		poll();
+		if (rebuilding || active.size() < buffer_limit) return;
+
+		std::swap(frozen, active);
+		active.clear();
+		rebuilding = true;
+		rebuilt.store(false, std::memory_order_relaxed);
+		rebuild_thread = std::thread([this]()
+		{
+			const size_t next_size = nst_rebuild_size<n>(main_keys.data(), main_keys.size(), frozen.keys.data(), frozen.keys.size(), frozen.tombstones.data(), frozen.tombstones.size());
+			next_keys.resize(next_size);
+			next_values.resize(next_size);
+			nst_rebuild<n>(main_keys.data(), main_values.data(), main_keys.size(), frozen.keys.data(), frozen.values.data(), frozen.keys.size(),
+				frozen.tombstones.data(), frozen.tombstones.size(), next_size, next_keys.data(), next_values.data());
+			rebuilt.store(true, std::memory_order_release);
+		});
+	}
+
+	void finish_rebuild()
+	{
+		rebuild_thread.join();
+		main_keys.swap(next_keys);
+		main_values.swap(next_values);
+		next_keys = page_vector<KeyTy>{};
+		next_values = page_vector<ValueTy>{};
+		frozen.clear();
+		rebuilding = false;
+	}
+};
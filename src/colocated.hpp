@@ -0,0 +1,227 @@
+#pragma once
+
+#include <cstdint>
+#include <algorithm>
+#include <limits>
+
+#include "balanced_binary.hpp"
+#include "bst.hpp"
+
+/*
+ * Where the value of a hit comes from. With separate key and value arrays
+ * (SoA), a hit in a large layout costs a second cache miss, and usually a
+ * second TLB miss, for values[idx] after the key has been found.
+ * value_layout::prefetched keeps the arrays apart but requests the values
+ * of a leaf as soon as the descent reaches it, together with its keys.
+ * Most keys sit in leaves (15/16 of them for 17-ary nodes).
+ * value_layout::colocated stores every node as n - 1 keys followed by their
+ * n - 1 values. The value line is then adjacent to the key line, in the
+ * same page, where the adjacent-line prefetcher usually has it already.
+ * Both work on the padded layout of nst_pad, whose nodes are all full.
+ */
+enum class value_layout
+{
+	separate,
+	prefetched,
+	colocated,
+};
+
+template<size_t n, class KeyTy, class ValueTy>
+constexpr size_t nst_colocated_node_bytes()
+{
+	return (n - 1) * (sizeof(KeyTy) + sizeof(ValueTy));
+}
+
+template<size_t n, class KeyTy, class ValueTy>
+size_t nst_colocated_bytes(size_t size)
+{
+	return nst_padded_size<n>(size) / (n - 1) * nst_colocated_node_bytes<n, KeyTy, ValueTy>();
+}
+
+// copies an nst_order layout into nodes of keys followed by their values, the last node is padded like nst_pad
+template<size_t n, class KeyTy, class ValueTy>
+void nst_colocate(const KeyTy* keys, const ValueTy* values, size_t size, void* blocks)
+{
+	const size_t padded = nst_padded_size<n>(size);
+	for (size_t i = 0; i < padded; i += n - 1)
+	{
+		KeyTy* node_keys = (KeyTy*)((uint8_t*)blocks + i / (n - 1) * nst_colocated_node_bytes<n, KeyTy, ValueTy>());
+		ValueTy* node_values = (ValueTy*)(node_keys + n - 1);
+		for (size_t k = 0; k < n - 1; ++k)
+		{
+			const bool pad = i + k >= size;
+			node_keys[k] = pad ? std::numeric_limits<KeyTy>::max() : keys[i + k];
+			node_values[k] = pad ? ValueTy{} : values[i + k];
+		}
+	}
+}
+
+// size is the padded size, ret is the layout position of target and value its value
+template<size_t n, class IntTy, class ValueTy>
+bool nst_search_colocated(const void* blocks, size_t size, IntTy target, size_t& ret, ValueTy& value)
+{
+	const size_t nodes = size / (n - 1);
+	for (size_t m = 0; m < nodes;)
+	{
+		const IntTy* keys = (const IntTy*)((const uint8_t*)blocks + m * nst_colocated_node_bytes<n, IntTy, ValueTy>());
+		size_t r = 0;
+		for (size_t k = 0; k < n - 1; ++k) r += keys[k] < target;
+		if (r < n - 1 && keys[r] == target)
+		{
+			ret = m * (n - 1) + r;
+			value = ((const ValueTy*)(keys + n - 1))[r];
+			return true;
+		}
+		m = m * n + r + 1;
+	}
+	return false;
+}
+
+#if defined(__SSE2__) || defined(__AVX2__)
+template<size_t n, class IntTy, class ValueTy>
+typename std::enable_if<!IsPacketNode<n, IntTy, 16>::value, bool>::type nst_search_value_prefetch_sse2(const IntTy* keys, const ValueTy*, size_t size, IntTy target, size_t& ret)
+{
+	return nst_search<n>(keys, size, target, ret);
+}
+
+// keys is an nst_pad layout, values is not padded
+template<size_t n, class IntTy, class ValueTy>
+typename std::enable_if<IsPacketNode<n, IntTy, 16>::value, bool>::type nst_search_value_prefetch_sse2(const IntTy* keys, const ValueTy* values, size_t size, IntTy target, size_t& ret)
+{
+	static constexpr size_t packet_size = 16 / sizeof(IntTy);
+
+	const __m128i ptarget = set1_sse2(target);
+	size_t i = 0;
+	while (i < size)
+	{
+		size_t c = 0;
+		for (size_t p = 0; p < (n - 1) / packet_size; ++p)
+		{
+			__m128i pkey = _mm_load_si128((const __m128i*)&keys[i + p * packet_size]);
+			c += popcount(_mm_movemask_epi8(cmpgt_sse2<IntTy>(ptarget, pkey)));
+		}
+		size_t r = c / sizeof(IntTy);
+		if (r < n - 1 && keys[i + r] == target)
+		{
+			ret = i + r;
+			return true;
+		}
+		i = i * n + (n - 1) * (r + 1);
+		if (i < size && i * n + (n - 1) >= size)
+		{
+			prefetch(&values[i]);
+			prefetch(&values[i + n - 2]);
+		}
+	}
+	return false;
+}
+
+template<size_t n, class IntTy, class ValueTy>
+typename std::enable_if<!IsPacketNode<n, IntTy, 16>::value, bool>::type nst_search_colocated_sse2(const void* blocks, size_t size, IntTy target, size_t& ret, ValueTy& value)
+{
+	return nst_search_colocated<n>(blocks, size, target, ret, value);
+}
+
+template<size_t n, class IntTy, class ValueTy>
+typename std::enable_if<IsPacketNode<n, IntTy, 16>::value, bool>::type nst_search_colocated_sse2(const void* blocks, size_t size, IntTy target, size_t& ret, ValueTy& value)
+{
+	static constexpr size_t packet_size = 16 / sizeof(IntTy);
+	static constexpr size_t node_bytes = nst_colocated_node_bytes<n, IntTy, ValueTy>();
+
+	const __m128i ptarget = set1_sse2(target);
+	const size_t nodes = size / (n - 1);
+	for (size_t m = 0; m < nodes;)
+	{
+		const IntTy* keys = (const IntTy*)((const uint8_t*)blocks + m * node_bytes);
+		size_t c = 0;
+		for (size_t p = 0; p < (n - 1) / packet_size; ++p)
+		{
+			__m128i pkey = _mm_loadu_si128((const __m128i*)&keys[p * packet_size]);
+			c += popcount(_mm_movemask_epi8(cmpgt_sse2<IntTy>(ptarget, pkey)));
+		}
+		size_t r = c / sizeof(IntTy);
+		if (r < n - 1 && keys[r] == target)
+		{
+			ret = m * (n - 1) + r;
+			value = ((const ValueTy*)(keys + n - 1))[r];
+			return true;
+		}
+		m = m * n + r + 1;
+	}
+	return false;
+}
+#endif
+
+#ifdef AVX2_KERNELS_AVAILABLE
+template<size_t n, class IntTy, class ValueTy>
+typename std::enable_if<!IsPacketNode<n, IntTy, 32>::value, bool>::type nst_search_value_prefetch_avx2(const IntTy* keys, const ValueTy*, size_t size, IntTy target, size_t& ret)
+{
+	return nst_search<n>(keys, size, target, ret);
+}
+
+template<size_t n, class IntTy, class ValueTy>
+TARGET_AVX2 typename std::enable_if<IsPacketNode<n, IntTy, 32>::value, bool>::type nst_search_value_prefetch_avx2(const IntTy* keys, const ValueTy* values, size_t size, IntTy target, size_t& ret)
+{
+	static constexpr size_t packet_size = 32 / sizeof(IntTy);
+
+	const __m256i ptarget = set1_avx2(target);
+	size_t i = 0;
+	while (i < size)
+	{
+		size_t c = 0;
+		for (size_t p = 0; p < (n - 1) / packet_size; ++p)
+		{
+			__m256i pkey = _mm256_load_si256((const __m256i*)&keys[i + p * packet_size]);
+			c += popcount(_mm256_movemask_epi8(cmpgt_avx2<IntTy>(ptarget, pkey)));
+		}
+		size_t r = c / sizeof(IntTy);
+		if (r < n - 1 && keys[i + r] == target)
+		{
+			ret = i + r;
+			return true;
+		}
+		i = i * n + (n - 1) * (r + 1);
+		if (i < size && i * n + (n - 1) >= size)
+		{
+			prefetch(&values[i]);
+			prefetch(&values[i + n - 2]);
+		}
+	}
+	return false;
+}
+
+template<size_t n, class IntTy, class ValueTy>
+typename std::enable_if<!IsPacketNode<n, IntTy, 32>::value, bool>::type nst_search_colocated_avx2(const void* blocks, size_t size, IntTy target, size_t& ret, ValueTy& value)
+{
+	return nst_search_colocated<n>(blocks, size, target, ret, value);
+}
+
+template<size_t n, class IntTy, class ValueTy>
+TARGET_AVX2 typename std::enable_if<IsPacketNode<n, IntTy, 32>::value, bool>::type nst_search_colocated_avx2(const void* blocks, size_t size, IntTy target, size_t& ret, ValueTy& value)
+{
+	static constexpr size_t packet_size = 32 / sizeof(IntTy);
+	static constexpr size_t node_bytes = nst_colocated_node_bytes<n, IntTy, ValueTy>();
+
+	const __m256i ptarget = set1_avx2(target);
+	const size_t nodes = size / (n - 1);
+	for (size_t m = 0; m < nodes;)
+	{
+		const IntTy* keys = (const IntTy*)((const uint8_t*)blocks + m * node_bytes);
+		size_t c = 0;
+		for (size_t p = 0; p < (n - 1) / packet_size; ++p)
+		{
+			__m256i pkey = _mm256_loadu_si256((const __m256i*)&keys[p * packet_size]);
+			c += popcount(_mm256_movemask_epi8(cmpgt_avx2<IntTy>(ptarget, pkey)));
+		}
+		size_t r = c / sizeof(IntTy);
+		if (r < n - 1 && keys[r] == target)
+		{
+			ret = m * (n - 1) + r;
+			value = ((const ValueTy*)(keys + n - 1))[r];
+			return true;
+		}
+		m = m * n + r + 1;
+	}
+	return false;
+}
+#endif
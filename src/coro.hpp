@@ -0,0 +1,244 @@
+#pragma once
+
+/*
+ * C++20 coroutine lookups. Each lookup issues prefetch() on the node it
+ * needs next and suspends, and lookup_scheduler resumes the in-flight
+ * lookups round-robin, so the miss of one is overlapped with the work of the
+ * others. Any call site can spawn a lookup_task, no batch loop is needed.
+ * Requires -std=c++20, the header is empty otherwise.
+ */
+#if defined(__cpp_impl_coroutine)
+#include <coroutine>
+#include <exception>
+#include <new>
+
+#include "balanced_binary.hpp"
+#include "bst.hpp"
+
+class coro_frame_pool
+{
+public:
+	static constexpr size_t slot_size = 512;
+	static constexpr size_t capacity = 64;
+
+	coro_frame_pool()
+	{
+		for (size_t i = 0; i < capacity; ++i) free_slots[i] = storage[i];
+		free_top = capacity;
+	}
+
+	// falls back to the heap for a frame above slot_size or when every slot is taken, which heap_frames() counts
+	void* allocate(size_t size)
+	{
+		if (size <= slot_size && free_top) return free_slots[--free_top];
+		++heap_count;
+		return ::operator new(size);
+	}
+
+	void deallocate(void* p)
+	{
+		if (p >= (void*)storage && p < (void*)(storage + capacity)) free_slots[free_top++] = (unsigned char*)p;
+		else ::operator delete(p);
+	}
+
+	size_t heap_frames() const { return heap_count; }
+
+	static coro_frame_pool& local()
+	{
+		thread_local coro_frame_pool pool;
+		return pool;
+	}
+
+private:
+	alignas(64) unsigned char storage[capacity][slot_size];
+	unsigned char* free_slots[capacity];
+	size_t free_top;
+	size_t heap_count = 0;
+};
+
+class lookup_task
+{
+public:
+	static constexpr size_t npos = (size_t)-1;
+
+	struct promise_type
+	{
+		size_t result = npos;
+
+		static void* operator new(size_t size)
+		{
+			return coro_frame_pool::local().allocate(size);
+		}
+
+		static void operator delete(void* p)
+		{
+			coro_frame_pool::local().deallocate(p);
+		}
+
+		lookup_task get_return_object()
+		{
+			return lookup_task{ std::coroutine_handle<promise_type>::from_promise(*this) };
+		}
+
+		std::suspend_always initial_suspend() noexcept { return {}; }
+		std::suspend_always final_suspend() noexcept { return {}; }
+		void return_value(size_t r) { result = r; }
+		void unhandled_exception() { std::terminate(); }
+	};
+
+	using handle_type = std::coroutine_handle<promise_type>;
+
+	lookup_task(lookup_task&& o) noexcept : handle{ o.handle } { o.handle = nullptr; }
+	lookup_task(const lookup_task&) = delete;
+	~lookup_task() { if (handle) handle.destroy(); }
+
+	handle_type release()
+	{
+		handle_type h = handle;
+		handle = nullptr;
+		return h;
+	}
+
+private:
+	explicit lookup_task(handle_type h) : handle{ h } {}
+
+	handle_type handle;
+};
+
+struct prefetch_suspend
+{
+	const void* ptr;
+
+	bool await_ready() const noexcept { return false; }
+	void await_suspend(std::coroutine_handle<>) const noexcept { prefetch(ptr); }
+	void await_resume() const noexcept {}
+};
+
+template<class IntTy>
+lookup_task balanced_binary_search_coro(const IntTy* keys, size_t size, IntTy target)
+{
+	static constexpr size_t cacheLineSize = 64 / sizeof(IntTy);
+
+	int height = ceil_log2(size + 1);
+	size_t dist = (size_t)1 << (size_t)(height - 1);
+	size_t mid = size - dist;
+	dist >>= 1;
+	size_t left1 = 0, left2 = mid + 1;
+	while (height-- > 0)
+	{
+		if (target > keys[mid]) left1 = left2;
+		left2 = left1 + dist;
+		mid = left1 + dist - 1;
+		if (dist >= cacheLineSize) co_await prefetch_suspend{ &keys[mid] };
+		dist >>= 1;
+	}
+	if (left1 == size || keys[left1] != target) co_return lookup_task::npos;
+	co_return left1;
+}
+
+template<class KeyTy>
+lookup_task bst_search_coro(const KeyTy* keys, size_t size, KeyTy target)
+{
+	size_t i = 0;
+	while (i < size)
+	{
+		if (target == keys[i]) co_return i;
+		i = target < keys[i] ? i * 2 + 1 : i * 2 + 2;
+		if (i < size) co_await prefetch_suspend{ &keys[i] };
+	}
+	co_return lookup_task::npos;
+}
+
+#ifdef __AVX2__
+template<size_t n, class IntTy>
+lookup_task nst_search_avx2_coro(const IntTy* keys, size_t size, IntTy target)
+{
+	static_assert((n - 1) % (32 / sizeof(IntTy)) == 0, "a node has to be made of whole 256-bit packets");
+	static constexpr size_t packet_size = 32 / sizeof(IntTy);
+	static constexpr size_t inner_size = (n - 1) / packet_size;
+
+	size_t i = 0, ret;
+	while (i < size)
+	{
+		// no vector is kept alive across the suspension, so the frame needs no 32-byte alignment
+		{
+			__m256i ptarget = set1_avx2(target);
+			size_t r = 0;
+			for (size_t p = 0; p < inner_size; ++p)
+			{
+				__m256i pkey = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&keys[i + p * packet_size]));
+				if (test_eq<IntTy>(cmpeq_avx2<IntTy>(ptarget, pkey), i + p * packet_size, size, ret)) co_return ret;
+				r += popcount(_mm256_movemask_epi8(cmpgt_avx2<IntTy>(ptarget, pkey)));
+			}
+			i = i * n + (n - 1) * (r / sizeof(IntTy) + 1);
+		}
+		if (i < size) co_await prefetch_suspend{ &keys[i] };
+	}
+	co_return lookup_task::npos;
+}
+#endif
+
+/*
+ * Runs up to `in_flight` lookups at once. sink(tag, result) is called with the
+ * tag given to spawn() when a lookup ends, result is lookup_task::npos on a miss.
+ * The task passed to spawn() is created while in_flight others are still
+ * live, so in_flight is capped one below the frame pool's capacity.
+ */
+template<class Sink>
+class lookup_scheduler
+{
+public:
+	lookup_scheduler(size_t _in_flight, Sink _sink)
+		: in_flight{ std::max(std::min(_in_flight, coro_frame_pool::capacity - 1), (size_t)1) }, sink{ _sink }
+	{
+	}
+
+	~lookup_scheduler()
+	{
+		drain();
+	}
+
+	void spawn(lookup_task&& task, size_t tag)
+	{
+		while (active == in_flight) step();
+		slots[active] = task.release();
+		tags[active] = tag;
+		++active;
+	}
+
+	void drain()
+	{
+		while (active) step();
+	}
+
+private:
+	void step()
+	{
+		if (cursor >= active) cursor = 0;
+		auto h = slots[cursor];
+		h.resume();
+		if (!h.done())
+		{
+			++cursor;
+			return;
+		}
+		sink(tags[cursor], h.promise().result);
+		h.destroy();
+		--active;
+		slots[cursor] = slots[active];
+		tags[cursor] = tags[active];
+	}
+
+	size_t in_flight;
+	Sink sink;
+	lookup_task::handle_type slots[coro_frame_pool::capacity];
+	size_t tags[coro_frame_pool::capacity];
+	size_t active = 0, cursor = 0;
+};
+
+template<class Sink>
+lookup_scheduler<Sink> make_lookup_scheduler(size_t in_flight, Sink sink)
+{
+	return lookup_scheduler<Sink>{ in_flight, sink };
+}
+#endif
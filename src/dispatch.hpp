@@ -0,0 +1,147 @@
+#pragma once
+
+#include <cstdint>
+
+#if defined(_MSC_VER) && defined(_M_X64)
+#include <intrin.h>
+#elif defined(__GNUC__) && defined(__x86_64__)
+#include <cpuid.h>
+#endif
+
+#include "balanced_binary.hpp"
+#include "bst.hpp"
+
+/*
+ * Runtime kernel selection. The CPU is probed once, and every
+ * *_dispatched<...> function pointer is resolved during static
+ * initialization, so a query costs one indirect call whatever the build
+ * flags were. Build without -march=native to get a binary that runs the
+ * AVX2 kernels where they are supported and the SSE2 ones elsewhere.
+ */
+
+enum class simd_level
+{
+	scalar,
+	sse2,
+	avx2,
+};
+
+inline const char* simd_level_name(simd_level level)
+{
+	switch (level)
+	{
+	case simd_level::sse2:
+		return "SSE2";
+	case simd_level::avx2:
+		return "AVX2";
+	default:
+		return "scalar";
+	}
+}
+
+#if defined(_M_X64) || defined(__x86_64__)
+inline void cpuid(uint32_t leaf, uint32_t subleaf, uint32_t regs[4])
+{
+#if defined(_MSC_VER)
+	int r[4];
+	__cpuidex(r, (int)leaf, (int)subleaf);
+	for (size_t i = 0; i < 4; ++i) regs[i] = (uint32_t)r[i];
+#else
+	__cpuid_count(leaf, subleaf, regs[0], regs[1], regs[2], regs[3]);
+#endif
+}
+
+inline uint64_t xgetbv(uint32_t index)
+{
+#if defined(_MSC_VER)
+	return _xgetbv(index);
+#else
+	uint32_t eax, edx;
+	__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(index));
+	return ((uint64_t)edx << 32) | eax;
+#endif
+}
+#endif
+
+inline simd_level detect_simd_level()
+{
+#if defined(_M_X64) || defined(__x86_64__)
+	uint32_t regs[4];
+	cpuid(0, 0, regs);
+	const uint32_t max_leaf = regs[0];
+
+	cpuid(1, 0, regs);
+	const bool osxsave = (regs[2] >> 27) & 1, avx = (regs[2] >> 28) & 1, popcnt = (regs[2] >> 23) & 1;
+	// the OS has to save the YMM registers on context switches
+	if (max_leaf >= 7 && osxsave && avx && popcnt && (xgetbv(0) & 6) == 6)
+	{
+		cpuid(7, 0, regs);
+		if ((regs[1] >> 5) & 1) return simd_level::avx2;
+	}
+	// SSE2 is part of the x86-64 baseline
+	return simd_level::sse2;
+#else
+	return simd_level::scalar;
+#endif
+}
+
+inline simd_level runtime_simd_level()
+{
+	static const simd_level level = detect_simd_level();
+	return level;
+}
+
+template<class IntTy>
+using search_fn = bool(*)(const IntTy*, size_t, IntTy, size_t&);
+
+// true if a node of n - 1 keys is served by a SIMD kernel with packet_bytes wide registers
+template<size_t n, class IntTy>
+constexpr bool has_simd_node(size_t packet_bytes)
+{
+	return n - 1 >= packet_bytes / sizeof(IntTy) && n - 1 <= 64 / sizeof(IntTy);
+}
+
+template<bool use_prefetch, class IntTy>
+search_fn<IntTy> select_balanced_binary_search(simd_level level)
+{
+#ifdef AVX2_KERNELS_AVAILABLE
+	if (level >= simd_level::avx2) return &balanced_binary_search_avx2<use_prefetch, IntTy>;
+#endif
+#if defined(__SSE2__) || defined(__AVX2__)
+	if (level >= simd_level::sse2) return &balanced_binary_search_sse2<use_prefetch, IntTy>;
+#endif
+	return &balanced_binary_search<use_prefetch, IntTy>;
+}
+
+template<size_t n, class IntTy>
+search_fn<IntTy> select_nst_search(simd_level level)
+{
+#ifdef AVX2_KERNELS_AVAILABLE
+	if (level >= simd_level::avx2 && has_simd_node<n, IntTy>(32)) return &nst_search_avx2<n, IntTy>;
+#endif
+#if defined(__SSE2__) || defined(__AVX2__)
+	if (level >= simd_level::sse2 && has_simd_node<n, IntTy>(16)) return &nst_search_sse2<n, IntTy>;
+#endif
+	return &nst_search<n, IntTy>;
+}
+
+template<size_t n, class IntTy>
+search_fn<IntTy> select_nst2_search(simd_level level)
+{
+#ifdef AVX2_KERNELS_AVAILABLE
+	if (level >= simd_level::avx2 && has_simd_node<n, IntTy>(32)) return &nst2_search_avx2<n, IntTy>;
+#endif
+#if defined(__SSE2__) || defined(__AVX2__)
+	if (level >= simd_level::sse2 && has_simd_node<n, IntTy>(16)) return &nst2_search_sse2<n, IntTy>;
+#endif
+	return &nst_search<n, IntTy>;
+}
+
+template<bool use_prefetch, class IntTy>
+const search_fn<IntTy> balanced_binary_search_dispatched = select_balanced_binary_search<use_prefetch, IntTy>(runtime_simd_level());
+
+template<size_t n, class IntTy>
+const search_fn<IntTy> nst_search_dispatched = select_nst_search<n, IntTy>(runtime_simd_level());
+
+template<size_t n, class IntTy>
+const search_fn<IntTy> nst2_search_dispatched = select_nst2_search<n, IntTy>(runtime_simd_level());
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "balanced_binary.hpp"
+#include "bst.hpp"
+#include "nst_iterator.hpp"
+
+/*
+ * Branchless search over the bst_order (Eytzinger) layout. With 1-based node
+ * numbers k, the children of k are 2k and 2k + 1, so one level is
+ * k = 2k + (key < target) and the descent has no data-dependent branch.
+ * Every step prefetches the descendants log2(64 / sizeof(KeyTy)) levels
+ * below k (16 nodes, 4 levels for int32). With 0-based storage those are
+ * keys[16k - 1 .. 16k + 14]: a line's worth of keys, but in a line-aligned
+ * array the first one is the last key of the line before, so the step
+ * prefetches both lines.
+ * The walk always ends past the last level. The right turns taken after the
+ * last left turn are the trailing one bits of k, so shifting them out (with
+ * the left turn itself) gives the node where the lower bound was found.
+ */
+
+// 1-based node number of the bound, 0 if every key precedes it
+template<bool inclusive, class KeyTy>
+inline size_t eytzinger_descend(const KeyTy* keys, size_t size, KeyTy target)
+{
+	static constexpr size_t block = 64 / sizeof(KeyTy);
+
+	size_t k = 1;
+	while (k <= size)
+	{
+		prefetch(keys + k * block - 1);
+		prefetch(keys + k * block + block - 2);
+		k = 2 * k + (inclusive ? !(target < keys[k - 1]) : keys[k - 1] < target);
+	}
+	return k >> (count_trailing_zeroes((uint64_t)~k) + 1);
+}
+
+template<class KeyTy>
+size_t eytzinger_lower_bound(const KeyTy* keys, size_t size, KeyTy target)
+{
+	size_t k = eytzinger_descend<false>(keys, size, target);
+	return k ? k - 1 : size;
+}
+
+template<class KeyTy>
+size_t eytzinger_upper_bound(const KeyTy* keys, size_t size, KeyTy target)
+{
+	size_t k = eytzinger_descend<true>(keys, size, target);
+	return k ? k - 1 : size;
+}
+
+template<class KeyTy>
+size_t eytzinger_predecessor(const KeyTy* keys, size_t size, KeyTy target)
+{
+	return nst_prev<2>(eytzinger_upper_bound(keys, size, target), size);
+}
+
+template<bound_kind kind, class KeyTy>
+size_t eytzinger_bound(const KeyTy* keys, size_t size, KeyTy target)
+{
+	if (kind == bound_kind::lower) return eytzinger_lower_bound(keys, size, target);
+	if (kind == bound_kind::upper) return eytzinger_upper_bound(keys, size, target);
+	return eytzinger_predecessor(keys, size, target);
+}
+
+template<class KeyTy>
+bool eytzinger_search(const KeyTy* keys, size_t size, KeyTy target, size_t& ret)
+{
+	size_t i = eytzinger_lower_bound(keys, size, target);
+	if (i == size || keys[i] != target) return false;
+	ret = i;
+	return true;
+}
@@ -0,0 +1,247 @@
+#pragma once
+
+#include <cstdint>
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#include "bst.hpp"
+#include "aligned_buffer.hpp"
+#include "page_alloc.hpp"
+
+/*
+ * Hierarchically blocked k-ary search tree after FAST (Kim et al., SIGMOD
+ * 2010). The nodes are those of nst_order<n>: n - 1 keys compared with the
+ * SIMD packets of the node kernels, and for n = 64 / sizeof(key) + 1 a node
+ * is one cache-line block. Those nodes are grouped into page blocks, each a
+ * subtree of block_depth levels stored in BFS order and never crossing a
+ * page, so a descent takes one TLB miss every block_depth levels instead of
+ * one per level. With 17-ary int32 nodes that is 2 levels per 4 KiB page
+ * and 4 per 2 MiB page.
+ * The blocks tile the complete levels of the tree from the bottom up, so
+ * only the top block can be shallower. The partial last level stays in BFS
+ * order on its own, which still keeps the children of a block together;
+ * blocking it as well would reserve slots for all of its missing nodes.
+ * A hit returns the nst_order position, where the searcher keeps the values.
+ */
+struct fast_tree
+{
+	aligned_buffer storage;
+	// first page boundary in storage, the blocked part starts there and the last level follows it
+	uint8_t* base = nullptr;
+	uint8_t* last_level = nullptr;
+	size_t nodes = 0;
+	size_t full_levels = 0;
+	size_t full_nodes = 0;
+	size_t block_depth = 0;
+	size_t top_depth = 0;
+	size_t block_nodes = 0;
+	size_t page_blocks = 0;
+	size_t page_nodes = 0;
+	// first block of every level of blocks
+	std::vector<size_t> level_blocks;
+};
+
+namespace detail
+{
+	inline size_t ipow(size_t b, size_t e)
+	{
+		size_t r = 1;
+		while (e--) r *= b;
+		return r;
+	}
+
+	// nodes above depth d of an n-ary tree, also the BFS index of the first node on depth d
+	inline size_t tree_nodes(size_t n, size_t d)
+	{
+		return (ipow(n, d) - 1) / (n - 1);
+	}
+}
+
+// first node slot of block b
+inline uint8_t* fast_block(const fast_tree& tree, size_t node_bytes, size_t b)
+{
+	return tree.base + (b / tree.page_blocks * tree.page_nodes + b % tree.page_blocks * tree.block_nodes) * node_bytes;
+}
+
+// keys is an nst_order<n> layout, the blocks are sized for and mapped with pages of kind
+template<size_t n, class IntTy>
+void fast_tree_build(fast_tree& tree, const IntTy* keys, size_t size, page_kind kind = default_page_kind())
+{
+	using detail::ipow;
+	using detail::tree_nodes;
+	static constexpr size_t node_bytes = (n - 1) * sizeof(IntTy);
+	const size_t page_size = page_bytes(kind);
+
+	tree.nodes = (size + n - 2) / (n - 1);
+	tree.full_levels = 0;
+	while (tree_nodes(n, tree.full_levels + 1) <= tree.nodes) ++tree.full_levels;
+	tree.full_nodes = tree_nodes(n, tree.full_levels);
+
+	tree.page_nodes = page_size / node_bytes;
+	tree.block_depth = 1;
+	while (tree_nodes(n, tree.block_depth + 1) <= tree.page_nodes) ++tree.block_depth;
+	tree.block_nodes = tree_nodes(n, tree.block_depth);
+	tree.page_blocks = tree.page_nodes / tree.block_nodes;
+
+	const size_t block_levels = (tree.full_levels + tree.block_depth - 1) / tree.block_depth;
+	tree.top_depth = tree.full_levels - tree.block_depth * (block_levels ? block_levels - 1 : 0);
+	tree.level_blocks.assign(1, 0);
+	for (size_t j = 0, root_depth = 0; j < block_levels; root_depth += j++ ? tree.block_depth : tree.top_depth)
+	{
+		tree.level_blocks.push_back(tree.level_blocks.back() + ipow(n, root_depth));
+	}
+
+	const size_t blocks = tree.level_blocks.back();
+	const size_t blocked_bytes = (blocks + tree.page_blocks - 1) / tree.page_blocks * page_size;
+	const size_t last_nodes = tree.nodes - tree.full_nodes;
+	tree.storage.allocate(page_size + blocked_bytes + last_nodes * node_bytes, kind);
+	tree.base = tree.storage.data<uint8_t>() + (page_size - (uintptr_t)tree.storage.data<uint8_t>() % page_size) % page_size;
+	tree.last_level = tree.base + blocked_bytes;
+
+	for (size_t j = 0, root_depth = 0; j < block_levels; root_depth += j++ ? tree.block_depth : tree.top_depth)
+	{
+		const size_t depth = j ? tree.block_depth : tree.top_depth;
+		for (size_t b = 0; b < ipow(n, root_depth); ++b)
+		{
+			const size_t root = tree_nodes(n, root_depth) + b;
+			for (size_t d = 0; d < depth; ++d)
+			{
+				for (size_t q = 0; q < ipow(n, d); ++q)
+				{
+					const size_t m = root * ipow(n, d) + tree_nodes(n, d) + q;
+					IntTy* out = (IntTy*)fast_block(tree, node_bytes, tree.level_blocks[j] + b) + (tree_nodes(n, d) + q) * (n - 1);
+					for (size_t k = 0; k < n - 1; ++k)
+					{
+						const size_t i = m * (n - 1) + k;
+						out[k] = i < size ? keys[i] : std::numeric_limits<IntTy>::max();
+					}
+				}
+			}
+		}
+	}
+
+	IntTy* out = (IntTy*)tree.last_level;
+	for (size_t i = tree.full_nodes * (n - 1); i < tree.nodes * (n - 1); ++i)
+	{
+		*out++ = i < size ? keys[i] : std::numeric_limits<IntTy>::max();
+	}
+}
+
+// rank(node, target) counts the keys of a node below target
+template<size_t n, class IntTy, class Rank>
+bool fast_tree_search_impl(const fast_tree& tree, size_t size, IntTy target, size_t& ret, Rank&& rank)
+{
+	using detail::ipow;
+	using detail::tree_nodes;
+	static constexpr size_t node_bytes = (n - 1) * sizeof(IntTy);
+
+	if (!size) return false;
+	// m is the BFS node number, local node l on local depth d of block b holds it
+	const size_t bottom_first = tree_nodes(n, tree.block_depth - 1), bottom_width = ipow(n, tree.block_depth - 1);
+	size_t m = 0, b = 0, l = 0, d = 0, j = 0, depth = tree.top_depth;
+	size_t first = tree_nodes(n, depth - 1), width = ipow(n, depth - 1);
+	const uint8_t* block = tree.base;
+	for (size_t level = 0;; ++level)
+	{
+		const bool blocked = level < tree.full_levels;
+		if (!blocked && m >= tree.nodes) return false;
+		const IntTy* node = (const IntTy*)(blocked ? block + l * node_bytes : tree.last_level + (m - tree.full_nodes) * node_bytes);
+
+		const size_t r = rank(node, target);
+		if (r < n - 1 && node[r] == target)
+		{
+			ret = m * (n - 1) + r;
+			return ret < size;
+		}
+		if (!blocked) return false;
+
+		m = m * n + r + 1;
+		if (d + 1 < depth)
+		{
+			l = l * n + r + 1;
+			++d;
+		}
+		else if (level + 1 < tree.full_levels)
+		{
+			b = (b * width + l - first) * n + r;
+			block = fast_block(tree, node_bytes, tree.level_blocks[++j] + b);
+			l = d = 0;
+			depth = tree.block_depth;
+			first = bottom_first;
+			width = bottom_width;
+		}
+	}
+}
+
+template<size_t n, class IntTy>
+inline size_t fast_node_rank(const IntTy* node, IntTy target)
+{
+	size_t r = 0;
+	for (size_t k = 0; k < n - 1; ++k) r += node[k] < target;
+	return r;
+}
+
+template<size_t n, class IntTy>
+bool fast_tree_search(const fast_tree& tree, size_t size, IntTy target, size_t& ret)
+{
+	return fast_tree_search_impl<n>(tree, size, target, ret, fast_node_rank<n, IntTy>);
+}
+
+#if defined(__SSE2__) || defined(__AVX2__)
+template<size_t n, class IntTy>
+inline typename std::enable_if<!IsPacketNode<n, IntTy, 16>::value, size_t>::type fast_node_rank_sse2(const IntTy* node, IntTy target)
+{
+	return fast_node_rank<n>(node, target);
+}
+
+template<size_t n, class IntTy>
+inline typename std::enable_if<IsPacketNode<n, IntTy, 16>::value, size_t>::type fast_node_rank_sse2(const IntTy* node, IntTy target)
+{
+	static constexpr size_t packet_size = 16 / sizeof(IntTy);
+
+	const __m128i ptarget = set1_sse2(target);
+	size_t c = 0;
+	for (size_t p = 0; p < (n - 1) / packet_size; ++p)
+	{
+		__m128i pkey = _mm_loadu_si128((const __m128i*)&node[p * packet_size]);
+		c += popcount(_mm_movemask_epi8(cmpgt_sse2<IntTy>(ptarget, pkey)));
+	}
+	return c / sizeof(IntTy);
+}
+
+template<size_t n, class IntTy>
+bool fast_tree_search_sse2(const fast_tree& tree, size_t size, IntTy target, size_t& ret)
+{
+	return fast_tree_search_impl<n>(tree, size, target, ret, fast_node_rank_sse2<n, IntTy>);
+}
+#endif
+
+#ifdef AVX2_KERNELS_AVAILABLE
+template<size_t n, class IntTy>
+inline typename std::enable_if<!IsPacketNode<n, IntTy, 32>::value, size_t>::type fast_node_rank_avx2(const IntTy* node, IntTy target)
+{
+	return fast_node_rank<n>(node, target);
+}
+
+template<size_t n, class IntTy>
+TARGET_AVX2 inline typename std::enable_if<IsPacketNode<n, IntTy, 32>::value, size_t>::type fast_node_rank_avx2(const IntTy* node, IntTy target)
+{
+	static constexpr size_t packet_size = 32 / sizeof(IntTy);
+
+	const __m256i ptarget = set1_avx2(target);
+	size_t c = 0;
+	for (size_t p = 0; p < (n - 1) / packet_size; ++p)
+	{
+		__m256i pkey = _mm256_loadu_si256((const __m256i*)&node[p * packet_size]);
+		c += popcount(_mm256_movemask_epi8(cmpgt_avx2<IntTy>(ptarget, pkey)));
+	}
+	return c / sizeof(IntTy);
+}
+
+template<size_t n, class IntTy>
+TARGET_AVX2 bool fast_tree_search_avx2(const fast_tree& tree, size_t size, IntTy target, size_t& ret)
+{
+	return fast_tree_search_impl<n>(tree, size, target, ret, fast_node_rank_avx2<n, IntTy>);
+}
+#endif
@@ -0,0 +1,207 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <type_traits>
+
+#include "bst.hpp"
+
+/*
+ * Frame-of-reference compressed k-ary search tree for 32- and 64-bit keys.
+ * Every node is one 64-byte line: the lowest key of the node as the base in
+ * its last sizeof(IntTy) bytes, and before it the offsets of the keys from
+ * the base as 16-bit lanes, so a node holds 30 int32 keys (31-ary tree) or
+ * 28 int64 keys (29-ary tree) instead of 16 or 8. The offsets are stored
+ * with the sign bit flipped, the signed int16 compares of the int16 kernels
+ * then order them as unsigned.
+ * A node whose keys span more than 16 bits keeps the fallback format: its
+ * first lane holds for_fallback_marker and the search compares the full
+ * keys of the plain nst_order layout, which the searcher keeps anyway for
+ * the values. The marker cannot be a compressed first lane, that is always
+ * the base itself, offset 0.
+ * Leaves hold consecutive keys, so they usually compress; the nodes near
+ * the root span most of the key range and fall back, but they stay cached.
+ * The fanout depends on the key size, use for_fanout<IntTy>().
+ */
+
+static constexpr int16_t for_fallback_marker = 0x7fff;
+
+template<class IntTy>
+constexpr size_t for_node_keys()
+{
+	return (64 - sizeof(IntTy)) / sizeof(int16_t);
+}
+
+template<class IntTy>
+constexpr size_t for_fanout()
+{
+	return for_node_keys<IntTy>() + 1;
+}
+
+template<class IntTy>
+size_t for_tree_bytes(size_t size)
+{
+	return (size + for_node_keys<IntTy>() - 1) / for_node_keys<IntTy>() * 64;
+}
+
+template<class IntTy>
+inline IntTy for_node_base(const uint8_t* node)
+{
+	IntTy base;
+	std::memcpy(&base, node + 64 - sizeof(IntTy), sizeof(IntTy));
+	return base;
+}
+
+// keys is an nst_order layout of fanout for_fanout<IntTy>(), nodes holds for_tree_bytes<IntTy>(size) bytes
+template<class IntTy>
+void for_compress(const IntTy* keys, size_t size, uint8_t* nodes)
+{
+	using UTy = typename std::make_unsigned<IntTy>::type;
+	static constexpr size_t node_keys = for_node_keys<IntTy>();
+
+	for (size_t i = 0; i < size; i += node_keys)
+	{
+		uint8_t* node = nodes + i / node_keys * 64;
+		int16_t* lanes = (int16_t*)node;
+		const size_t real = std::min(node_keys, size - i);
+		const IntTy base = keys[i];
+		if ((UTy)keys[i + real - 1] - (UTy)base > 0xffff)
+		{
+			std::fill(lanes, lanes + node_keys, for_fallback_marker);
+		}
+		else
+		{
+			for (size_t k = 0; k < node_keys; ++k)
+			{
+				const uint16_t offset = k < real ? (uint16_t)((UTy)keys[i + k] - (UTy)base) : 0xffff;
+				lanes[k] = (int16_t)(offset ^ 0x8000);
+			}
+		}
+		std::memcpy(node + 64 - sizeof(IntTy), &base, sizeof(IntTy));
+	}
+}
+
+// biased offset of target from base, returns false if target is outside the 16-bit frame and sets r to the rank it has in the node then
+template<class IntTy>
+inline bool for_offset(IntTy base, IntTy target, int16_t& t, size_t& r)
+{
+	using UTy = typename std::make_unsigned<IntTy>::type;
+	if (target < base)
+	{
+		r = 0;
+		return false;
+	}
+	const UTy d = (UTy)target - (UTy)base;
+	if (d > 0xffff)
+	{
+		r = for_node_keys<IntTy>();
+		return false;
+	}
+	t = (int16_t)((uint16_t)d ^ 0x8000);
+	return true;
+}
+
+template<class IntTy>
+bool nst_search_for(const uint8_t* nodes, const IntTy* keys, size_t size, IntTy target, size_t& ret)
+{
+	static constexpr size_t n = for_fanout<IntTy>();
+
+	size_t i = 0;
+	while (i < size)
+	{
+		const uint8_t* node = nodes + i / (n - 1) * 64;
+		const int16_t* lanes = (const int16_t*)node;
+		size_t r = 0;
+		if (lanes[0] == for_fallback_marker)
+		{
+			const size_t ke = std::min(n - 1, size - i);
+			for (size_t k = 0; k < ke; ++k) r += keys[i + k] < target;
+			if (r < ke && keys[i + r] == target)
+			{
+				ret = i + r;
+				return true;
+			}
+		}
+		else
+		{
+			int16_t t;
+			if (for_offset(for_node_base<IntTy>(node), target, t, r))
+			{
+				for (size_t k = 0; k < n - 1; ++k) r += lanes[k] < t;
+				if (r < n - 1 && lanes[r] == t && i + r < size)
+				{
+					ret = i + r;
+					return true;
+				}
+			}
+		}
+		i = i * n + (n - 1) * (r + 1);
+	}
+	return false;
+}
+
+#ifdef AVX2_KERNELS_AVAILABLE
+template<class IntTy>
+TARGET_AVX2 bool nst_search_for_avx2(const uint8_t* nodes, const IntTy* keys, size_t size, IntTy target, size_t& ret)
+{
+	static constexpr size_t n = for_fanout<IntTy>();
+	static constexpr size_t packet_size = 32 / sizeof(IntTy);
+	static constexpr size_t packets = (n - 1 + packet_size - 1) / packet_size;
+	// movemask bits of the key lanes in the last packet of a fallback node, and of the offset lanes in the upper half of a compressed one
+	static constexpr uint32_t key_mask = (uint32_t)(((uint64_t)1 << ((n - 1 - (packets - 1) * packet_size) * sizeof(IntTy))) - 1);
+	static constexpr uint32_t lane_mask = (uint32_t)(((uint64_t)1 << ((n - 1 - 16) * 2)) - 1);
+
+	const __m256i ptarget = set1_avx2(target);
+	size_t i = 0;
+	while (i < size)
+	{
+		const uint8_t* node = nodes + i / (n - 1) * 64;
+		size_t r = 0;
+		if (*(const int16_t*)node == for_fallback_marker)
+		{
+			if (i + packets * packet_size > size)
+			{
+				const size_t ke = std::min(n - 1, size - i);
+				for (size_t k = 0; k < ke; ++k) r += keys[i + k] < target;
+			}
+			else
+			{
+				size_t c = 0;
+				for (size_t p = 0; p + 1 < packets; ++p)
+				{
+					__m256i pkey = _mm256_loadu_si256((const __m256i*)&keys[i + p * packet_size]);
+					c += popcount(_mm256_movemask_epi8(cmpgt_avx2<IntTy>(ptarget, pkey)));
+				}
+				__m256i pkey = _mm256_loadu_si256((const __m256i*)&keys[i + (packets - 1) * packet_size]);
+				c += popcount((uint32_t)_mm256_movemask_epi8(cmpgt_avx2<IntTy>(ptarget, pkey)) & key_mask);
+				r = c / sizeof(IntTy);
+			}
+			if (r < n - 1 && i + r < size && keys[i + r] == target)
+			{
+				ret = i + r;
+				return true;
+			}
+		}
+		else
+		{
+			int16_t t;
+			if (for_offset(for_node_base<IntTy>(node), target, t, r))
+			{
+				const __m256i pt = _mm256_set1_epi16(t);
+				__m256i lo = _mm256_load_si256((const __m256i*)node);
+				__m256i hi = _mm256_load_si256((const __m256i*)(node + 32));
+				r = (popcount(_mm256_movemask_epi8(_mm256_cmpgt_epi16(pt, lo)))
+					+ popcount((uint32_t)_mm256_movemask_epi8(_mm256_cmpgt_epi16(pt, hi)) & lane_mask)) / 2;
+				if (r < n - 1 && ((const int16_t*)node)[r] == t && i + r < size)
+				{
+					ret = i + r;
+					return true;
+				}
+			}
+		}
+		i = i * n + (n - 1) * (r + 1);
+	}
+	return false;
+}
+#endif
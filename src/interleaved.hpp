@@ -0,0 +1,138 @@
+#pragma once
+
+#include <algorithm>
+
+#include "balanced_binary.hpp"
+#include "bst.hpp"
+
+/*
+ * Interleaved lookups over a probe stream. Up to `group_size` queries are kept
+ * in flight per thread, each one prefetches the node it will touch next and
+ * control round-robins to the other queries while the line is being fetched.
+ * Tune `group_size` to the memory-level parallelism of the machine.
+ */
+
+static constexpr size_t max_group_size = 64;
+
+inline size_t clamp_group_size(size_t group_size)
+{
+	return std::max(std::min(group_size, max_group_size), (size_t)1);
+}
+
+// group prefetching: every query of a group descends one level per round
+template<class IntTy, class ValueTy>
+void balanced_binary_search_group(const IntTy* keys, const ValueTy* values, size_t size, const IntTy* targets, size_t n_targets, ValueTy* out, uint8_t* found, size_t group_size)
+{
+	group_size = clamp_group_size(group_size);
+	size_t left1[max_group_size], left2[max_group_size], mid[max_group_size];
+
+	const int height = ceil_log2(size + 1);
+	const size_t top_dist = (size_t)1 << (size_t)(height - 1);
+
+	for (size_t j = 0; j < n_targets; j += group_size)
+	{
+		const size_t g_size = std::min(group_size, n_targets - j);
+		const IntTy* t = targets + j;
+
+		size_t dist = top_dist;
+		for (size_t g = 0; g < g_size; ++g)
+		{
+			mid[g] = size - dist;
+			left1[g] = 0;
+			left2[g] = mid[g] + 1;
+		}
+		dist >>= 1;
+
+		for (int h = height; h > 0; --h)
+		{
+			for (size_t g = 0; g < g_size; ++g)
+			{
+				left1[g] = t[g] > keys[mid[g]] ? left2[g] : left1[g];
+				left2[g] = left1[g] + dist;
+				mid[g] = left1[g] + dist - 1;
+				prefetch(&keys[mid[g] + (h == 1)]);
+			}
+			dist >>= 1;
+		}
+
+		for (size_t g = 0; g < g_size; ++g)
+		{
+			found[j + g] = left1[g] < size && keys[left1[g]] == t[g];
+			if (found[j + g]) out[j + g] = values[left1[g]];
+		}
+	}
+}
+
+// asynchronous memory access chaining: a slot is refilled with the next query as soon as its lookup ends
+template<size_t n, class IntTy, class ValueTy>
+void nst_search_amac(const IntTy* keys, const ValueTy* values, size_t size, const IntTy* targets, size_t n_targets, ValueTy* out, uint8_t* found, size_t group_size)
+{
+	group_size = clamp_group_size(group_size);
+	size_t node[max_group_size], query[max_group_size];
+
+	size_t next_query = 0, in_flight = 0;
+	for (; in_flight < group_size && next_query < n_targets; ++in_flight)
+	{
+		node[in_flight] = 0;
+		query[in_flight] = next_query++;
+	}
+
+	size_t g = 0;
+	while (in_flight)
+	{
+		if (g >= in_flight) g = 0;
+
+		size_t i = node[g], q = query[g], ret = 0;
+		const IntTy target = targets[q];
+		bool hit = false;
+		if (i < size)
+		{
+			size_t r = 0;
+			size_t ke = std::min(n - 1, size - i);
+			for (size_t k = 0; k < ke; ++k)
+			{
+				if (target == keys[i + k])
+				{
+					ret = i + k;
+					hit = true;
+					break;
+				}
+				if (target > keys[i + k]) r++;
+			}
+			i = i * n + (n - 1) * (r + 1);
+		}
+
+		if (hit || i >= size)
+		{
+			found[q] = hit;
+			if (hit) out[q] = values[ret];
+
+			if (next_query < n_targets)
+			{
+				node[g] = 0;
+				query[g] = next_query++;
+			}
+			else
+			{
+				--in_flight;
+				node[g] = node[in_flight];
+				query[g] = query[in_flight];
+				continue;
+			}
+		}
+		else
+		{
+			node[g] = i;
+			prefetch(&keys[i]);
+			prefetch(&keys[i + n - 2]);
+		}
+		++g;
+	}
+}
+
+// bst_order is the 2-ary case of nst_order
+template<class IntTy, class ValueTy>
+void bst_search_amac(const IntTy* keys, const ValueTy* values, size_t size, const IntTy* targets, size_t n_targets, ValueTy* out, uint8_t* found, size_t group_size)
+{
+	nst_search_amac<2>(keys, values, size, targets, n_targets, out, found, group_size);
+}
@@ -0,0 +1,185 @@
+#pragma once
+
+#include <cstdint>
+#include <algorithm>
+
+#include "balanced_binary.hpp"
+#include "bst.hpp"
+
+/*
+ * Interpolation searches over sorted keys for near-uniform key spaces.
+ * SIP (interpolation-sequential) probes the interpolated position and, if
+ * the keys at the edges of a few cache lines around it bracket the target,
+ * scans those lines; otherwise the window shrinks past them and the next
+ * guess interpolates the smaller window. TIP (three-point interpolation)
+ * fits the guess through the two bounds of the window and the bound it
+ * replaced, which follows a curved CDF better than a line, and probes the
+ * guess and a guard key one scan window beyond it. Both scan the window linearly once it is a few cache lines wide,
+ * and both give up interpolating after interpolation_max_steps steps and
+ * finish with balanced_binary_search, so skewed keys cost at most a fixed
+ * number of extra probes.
+ */
+
+static constexpr size_t interpolation_max_steps = 8;
+
+template<class IntTy>
+constexpr size_t interpolation_scan_keys()
+{
+	return 4 * 64 / sizeof(IntTy);
+}
+
+template<class IntTy>
+bool linear_scan_search(const IntTy* keys, size_t size, IntTy target, size_t& ret)
+{
+	size_t r = 0;
+	for (size_t i = 0; i < size; ++i) r += keys[i] < target;
+	if (r < size && keys[r] == target)
+	{
+		ret = r;
+		return true;
+	}
+	return false;
+}
+
+#ifdef AVX2_KERNELS_AVAILABLE
+template<class IntTy>
+TARGET_AVX2 bool linear_scan_search_avx2(const IntTy* keys, size_t size, IntTy target, size_t& ret)
+{
+	static constexpr size_t packet_size = 32 / sizeof(IntTy);
+
+	const __m256i ptarget = set1_avx2(target);
+	size_t c = 0, i = 0;
+	for (; i + packet_size <= size; i += packet_size)
+	{
+		__m256i pkey = _mm256_loadu_si256((const __m256i*)&keys[i]);
+		c += popcount(_mm256_movemask_epi8(cmpgt_avx2<IntTy>(ptarget, pkey)));
+	}
+	size_t r = c / sizeof(IntTy);
+	for (; i < size; ++i) r += keys[i] < target;
+	if (r < size && keys[r] == target)
+	{
+		ret = r;
+		return true;
+	}
+	return false;
+}
+#endif
+
+// position of target in [lo, hi] interpolated linearly between keys x0 at lo and x2 at hi
+inline double interpolate_linear(double t, double x0, double lo, double x2, double hi)
+{
+	return lo + (t - x0) * (hi - lo) / (x2 - x0);
+}
+
+// inverse quadratic interpolation through (x0, y0), (x1, y1), (x2, y2)
+inline double interpolate_three_point(double t, double x0, double y0, double x1, double y1, double x2, double y2)
+{
+	return y0 * (t - x1) * (t - x2) / ((x0 - x1) * (x0 - x2))
+		+ y1 * (t - x0) * (t - x2) / ((x1 - x0) * (x1 - x2))
+		+ y2 * (t - x0) * (t - x1) / ((x2 - x0) * (x2 - x1));
+}
+
+// scan(keys, size, target, ret) searches the final window
+template<bool three_point, class IntTy, class Scan>
+bool interpolation_search_impl(const IntTy* keys, size_t size, IntTy target, size_t& ret, Scan&& scan)
+{
+	static constexpr size_t scan_keys = interpolation_scan_keys<IntTy>();
+
+	// the window [lo, hi) holds target if it is present, (px, py) is the bound TIP replaced last
+	size_t lo = 0, hi = size;
+	double px = 0, py = -1;
+	for (size_t step = 0; step < interpolation_max_steps; ++step)
+	{
+		if (hi - lo <= scan_keys)
+		{
+			if (!scan(keys + lo, hi - lo, target, ret)) return false;
+			ret += lo;
+			return true;
+		}
+
+		const IntTy k0 = keys[lo], k2 = keys[hi - 1];
+		if (!(k0 < target && target < k2))
+		{
+			ret = target == k0 ? lo : hi - 1;
+			return target == k0 || target == k2;
+		}
+
+		const double t = (double)target, x0 = (double)k0, x2 = (double)k2;
+		double p = interpolate_linear(t, x0, (double)lo, x2, (double)(hi - 1));
+		if (three_point && py >= 0)
+		{
+			const double q = interpolate_three_point(t, x0, (double)lo, px, py, x2, (double)(hi - 1));
+			if (q > (double)lo && q < (double)(hi - 1)) p = q;
+		}
+		const size_t m = std::min(std::max((size_t)p, lo + 1), hi - 2);
+
+		if (three_point)
+		{
+			const IntTy km = keys[m];
+			if (km == target)
+			{
+				ret = m;
+				return true;
+			}
+			// a guard probe one scan window past m closes the window when the guess was close
+			if (km < target)
+			{
+				px = x0;
+				py = (double)lo;
+				lo = m + 1;
+				if (m + scan_keys < hi && target < keys[m + scan_keys]) hi = m + scan_keys;
+			}
+			else
+			{
+				px = x2;
+				py = (double)(hi - 1);
+				hi = m;
+				if (m > lo + scan_keys && keys[m - scan_keys] < target) lo = m - scan_keys + 1;
+			}
+		}
+		else
+		{
+			// scan the lines around m if their edge keys bracket target
+			const size_t a = m > lo + scan_keys / 2 ? m - scan_keys / 2 : lo;
+			const size_t b = std::min(a + scan_keys, hi);
+			if (target < keys[a]) hi = a;
+			else if (keys[b - 1] < target) lo = b;
+			else
+			{
+				if (!scan(keys + a, b - a, target, ret)) return false;
+				ret += a;
+				return true;
+			}
+		}
+	}
+
+	if (!balanced_binary_search<false>(keys + lo, hi - lo, target, ret)) return false;
+	ret += lo;
+	return true;
+}
+
+template<class IntTy>
+bool sip_search(const IntTy* keys, size_t size, IntTy target, size_t& ret)
+{
+	return interpolation_search_impl<false>(keys, size, target, ret, linear_scan_search<IntTy>);
+}
+
+template<class IntTy>
+bool tip_search(const IntTy* keys, size_t size, IntTy target, size_t& ret)
+{
+	return interpolation_search_impl<true>(keys, size, target, ret, linear_scan_search<IntTy>);
+}
+
+#ifdef AVX2_KERNELS_AVAILABLE
+template<class IntTy>
+TARGET_AVX2 bool sip_search_avx2(const IntTy* keys, size_t size, IntTy target, size_t& ret)
+{
+	return interpolation_search_impl<false>(keys, size, target, ret, linear_scan_search_avx2<IntTy>);
+}
+
+template<class IntTy>
+TARGET_AVX2 bool tip_search_avx2(const IntTy* keys, size_t size, IntTy target, size_t& ret)
+{
+	return interpolation_search_impl<true>(keys, size, target, ret, linear_scan_search_avx2<IntTy>);
+}
+#endif
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <type_traits>
+
+#include "aligned_buffer.hpp"
+
+/*
+ * Order-preserving key transforms. The SIMD kernels compare signed lanes, so
+ * unsigned and floating-point keys are mapped onto signed integers of the same
+ * width whose signed order is the order of the original keys:
+ * unsigned keys get their sign bit flipped, IEEE-754 keys get their magnitude
+ * bits flipped when negative. Signed integer keys are passed through as they are.
+ * The keys are transformed once in prepare(), the target once per query.
+ */
+
+template<size_t size> struct signed_int_of;
+template<> struct signed_int_of<1> { using type = int8_t; };
+template<> struct signed_int_of<2> { using type = int16_t; };
+template<> struct signed_int_of<4> { using type = int32_t; };
+template<> struct signed_int_of<8> { using type = int64_t; };
+
+template<class KeyTy, class = void>
+struct ordered_key
+{
+	using type = KeyTy;
+
+	static type encode(KeyTy v) { return v; }
+};
+
+template<class KeyTy>
+struct ordered_key<KeyTy, typename std::enable_if<std::is_unsigned<KeyTy>::value>::type>
+{
+	using type = typename signed_int_of<sizeof(KeyTy)>::type;
+
+	static type encode(KeyTy v)
+	{
+		return (type)(KeyTy)(v ^ ((KeyTy)1 << (sizeof(KeyTy) * 8 - 1)));
+	}
+};
+
+template<class KeyTy>
+struct ordered_key<KeyTy, typename std::enable_if<std::is_floating_point<KeyTy>::value>::type>
+{
+	static_assert(std::numeric_limits<KeyTy>::is_iec559, "only IEEE-754 keys are supported");
+	using type = typename signed_int_of<sizeof(KeyTy)>::type;
+
+	static type encode(KeyTy v)
+	{
+		// -0.0 + 0.0 == +0.0, so both zeros map to the same key
+		v += (KeyTy)0;
+		type b;
+		std::memcpy(&b, &v, sizeof(b));
+		return b ^ ((b >> (sizeof(type) * 8 - 1)) & std::numeric_limits<type>::max());
+	}
+};
+
+template<class KeyTy>
+using ordered_key_t = typename ordered_key<KeyTy>::type;
+
+template<class KeyTy>
+using is_ordered_key = std::is_same<ordered_key_t<KeyTy>, KeyTy>;
+
+template<class KeyTy>
+inline ordered_key_t<KeyTy> to_ordered(KeyTy v)
+{
+	return ordered_key<KeyTy>::encode(v);
+}
+
+/*
+ * The keys a searcher runs the kernels on. Keys that are their own ordered
+ * type are used where they are; other keys are transformed into integer
+ * storage owned here, so float and unsigned storage of the caller is never
+ * accessed as another type. The caller's keys are left in their order: the
+ * searcher arranges the transformed copy along with the values.
+ */
+class ordered_key_storage
+{
+public:
+	// transforms keys and returns the ordered keys to arrange and search
+	template<class KeyTy>
+	ordered_key_t<KeyTy>* assign(KeyTy* keys, size_t size)
+	{
+		return assign(keys, size, is_ordered_key<KeyTy>{});
+	}
+
+	// the ordered keys of the last assign(), given the keys passed to it
+	template<class KeyTy>
+	const ordered_key_t<KeyTy>* get(const KeyTy* keys) const
+	{
+		return get(keys, is_ordered_key<KeyTy>{});
+	}
+
+private:
+	aligned_buffer buffer;
+
+	template<class KeyTy>
+	KeyTy* assign(KeyTy* keys, size_t, std::true_type)
+	{
+		return keys;
+	}
+
+	template<class KeyTy>
+	ordered_key_t<KeyTy>* assign(const KeyTy* keys, size_t size, std::false_type)
+	{
+		using OKeyTy = ordered_key_t<KeyTy>;
+		OKeyTy* okeys = (OKeyTy*)buffer.allocate(size * sizeof(OKeyTy));
+		for (size_t i = 0; i < size; ++i) okeys[i] = to_ordered(keys[i]);
+		return okeys;
+	}
+
+	template<class KeyTy>
+	const KeyTy* get(const KeyTy* keys, std::true_type) const
+	{
+		return keys;
+	}
+
+	template<class KeyTy>
+	const ordered_key_t<KeyTy>* get(const KeyTy*, std::false_type) const
+	{
+		return buffer.data<ordered_key_t<KeyTy>>();
+	}
+};
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <cstdint>
+#include <algorithm>
+#include <vector>
+
+#include "balanced_binary.hpp"
+
+/*
+ * Two-stage recursive model index (RMI) over sorted keys. The root is a
+ * least-squares line from key to model number, each second-stage model is
+ * a least-squares line from key to position fitted on the keys the root
+ * sends to it, together with the largest errors of its predictions on
+ * those keys. A lookup evaluates two lines and then searches only the
+ * window [prediction - err_lo, prediction + err_hi], so on keys with a
+ * smooth CDF it touches the model and one or two lines of keys.
+ * Floating-point rounding is monotone, so the root sends contiguous ranges
+ * of keys to the models, and every line is fitted relative to the first
+ * key of its range to keep the sums small. The bounds get one extra
+ * position on each side in case the search evaluates the lines with a
+ * different contraction of the multiply-add than the training did.
+ */
+class learned_index
+{
+public:
+	struct linear_model
+	{
+		double x0 = 0;
+		double slope = 0;
+		double base = 0;
+		uint32_t err_lo = 0;
+		uint32_t err_hi = 0;
+
+		// base + slope * (x - x0), clamped to [0, limit]
+		size_t predict(double x, size_t limit) const
+		{
+			const double p = base + slope * (x - x0);
+			if (!(p > 0)) return 0;
+			if (p >= (double)limit) return limit;
+			return (size_t)p;
+		}
+	};
+
+	// keys must be sorted, one second-stage model per keys_per_model keys
+	template<class KeyTy>
+	void build(const KeyTy* keys, size_t size, size_t keys_per_model = 256)
+	{
+		models.assign(std::max(size / keys_per_model, (size_t)1), linear_model{});
+		root = fit(keys, 0, size);
+		const double scale = size ? (double)models.size() / size : 0;
+		root.slope *= scale;
+		root.base *= scale;
+
+		for (size_t first = 0, m = 0; m < models.size(); ++m)
+		{
+			size_t last = first;
+			while (last < size && model_of((double)keys[last]) == m) ++last;
+
+			linear_model& model = models[m];
+			model = fit(keys, first, last);
+			model.err_lo = model.err_hi = 1;
+			for (size_t i = first; i < last; ++i)
+			{
+				const size_t p = model.predict((double)keys[i], size - 1);
+				if (p > i) model.err_lo = std::max(model.err_lo, (uint32_t)(p - i + 1));
+				else model.err_hi = std::max(model.err_hi, (uint32_t)(i - p + 1));
+			}
+			first = last;
+		}
+	}
+
+	// positions [lo, hi) that hold target if it is present
+	template<class KeyTy>
+	void window(KeyTy target, size_t size, size_t& lo, size_t& hi) const
+	{
+		const double x = (double)target;
+		const linear_model& model = models[model_of(x)];
+		const size_t p = model.predict(x, size - 1);
+		lo = p > model.err_lo ? p - model.err_lo : 0;
+		hi = std::min(p + model.err_hi + 1, size);
+	}
+
+	size_t model_count() const { return models.size(); }
+
+private:
+	linear_model root;
+	std::vector<linear_model> models;
+
+	size_t model_of(double x) const
+	{
+		return root.predict(x, models.size() - 1);
+	}
+
+	// least-squares line through (keys[i], i) for i in [first, last)
+	template<class KeyTy>
+	static linear_model fit(const KeyTy* keys, size_t first, size_t last)
+	{
+		linear_model model;
+		model.base = (double)first;
+		if (last - first < 2)
+		{
+			if (last > first) model.x0 = (double)keys[first];
+			return model;
+		}
+
+		model.x0 = (double)keys[first];
+		const double count = (double)(last - first);
+		double sx = 0, sy = 0, sxx = 0, sxy = 0;
+		for (size_t i = first; i < last; ++i)
+		{
+			const double x = (double)keys[i] - model.x0, y = (double)(i - first);
+			sx += x;
+			sy += y;
+			sxx += x * x;
+			sxy += x * y;
+		}
+		const double var = sxx - sx * sx / count;
+		if (var > 0) model.slope = (sxy - sx * sy / count) / var;
+		model.base = (double)first + (sy - model.slope * sx) / count;
+		return model;
+	}
+};
+
+template<class IntTy>
+bool learned_search(const learned_index& index, const IntTy* keys, size_t size, IntTy target, size_t& ret)
+{
+	if (!size) return false;
+	size_t lo, hi;
+	index.window(target, size, lo, hi);
+	if (!balanced_binary_search<false>(keys + lo, hi - lo, target, ret)) return false;
+	ret += lo;
+	return true;
+}
+
+#ifdef AVX2_KERNELS_AVAILABLE
+template<class IntTy>
+TARGET_AVX2 bool learned_search_avx2(const learned_index& index, const IntTy* keys, size_t size, IntTy target, size_t& ret)
+{
+	if (!size) return false;
+	size_t lo, hi;
+	index.window(target, size, lo, hi);
+	if (!balanced_binary_search_avx2<false>(keys + lo, hi - lo, target, ret)) return false;
+	ret += lo;
+	return true;
+}
+#endif
@@ -9,63 +9,95 @@
 #include <iostream>
 #include <algorithm>
 #include <numeric>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <cstring>
 
 #include "static_str.hpp"
+#include "key_order.hpp"
 #include "balanced_binary.hpp"
 #include "bst.hpp"
+#include "batch.hpp"
+#include "interleaved.hpp"
+#include "coro.hpp"
+#include "dispatch.hpp"
+#include "nst_iterator.hpp"
+#include "eytzinger.hpp"
+#include "nst_build.hpp"
+#include "nst_merge.hpp"
+#include "aligned_buffer.hpp"
+#include "page_alloc.hpp"
+#include "colocated.hpp"
+#include "for_tree.hpp"
+#include "truncated_tree.hpp"
+#include "learned.hpp"
+#include "interpolation.hpp"
+#include "fast_tree.hpp"
+#include "radix_directory.hpp"
+#include "buffered_nst.hpp"
+#include "snapshot_index.hpp"
+#include "affinity.hpp"
 
 using namespace std;
 
+template<class IntTy>
+using KeyDist = typename conditional<is_floating_point<IntTy>::value,
+	uniform_real_distribution<IntTy>,
+	uniform_int_distribution<typename conditional<sizeof(IntTy) == 1, int16_t, IntTy>::type>
+>::type;
+
+template<class IntTy>
+typename enable_if<!is_floating_point<IntTy>::value, KeyDist<IntTy>>::type key_dist(bool uniform)
+{
+	if (uniform) return KeyDist<IntTy>{ numeric_limits<IntTy>::min(), numeric_limits<IntTy>::max() };
+	return KeyDist<IntTy>{ numeric_limits<IntTy>::min() / 2, numeric_limits<IntTy>::max() / 2 + numeric_limits<IntTy>::max() / 4 };
+}
+
+// floating-point keys are drawn from a fixed range with the same proportions
+template<class IntTy>
+typename enable_if<is_floating_point<IntTy>::value, KeyDist<IntTy>>::type key_dist(bool uniform)
+{
+	if (uniform) return KeyDist<IntTy>{ -1e6, 1e6 };
+	return KeyDist<IntTy>{ -5e5, 7.5e5 };
+}
+
 template<class IntTy>
 vector<IntTy> unique_rand_array(size_t size, bool uniform = true, size_t seed = 42)
 {
-	using SIntTy = typename conditional<sizeof(IntTy) == 1, int16_t, IntTy>::type;
-	vector<IntTy> ret(size);
+	vector<IntTy> ret;
+	ret.reserve(size);
 	mt19937_64 rng{ seed };
 
-	unordered_set<IntTy> uniq;
-	size_t i = 0;
-
-	if (uniform)
-	{
-		uniform_int_distribution<SIntTy> dist{ numeric_limits<IntTy>::min(), numeric_limits<IntTy>::max() };
-		while(i < size)
-		{
-			auto t = (IntTy)dist(rng);
-			if (uniq.count(t)) continue;
-			uniq.emplace(t);
-			ret[i++] = t;
-		}
-	}
-	else
+	auto dist = key_dist<IntTy>(uniform);
+	// draws the missing keys and drops the duplicates until there are enough,
+	// a hash set of the keys would not fit in memory at 10^9 keys
+	while (ret.size() < size)
 	{
-		uniform_int_distribution<SIntTy> dist{ numeric_limits<IntTy>::min() / 2, numeric_limits<IntTy>::max() / 2 + numeric_limits<IntTy>::max() / 4 };
-		while (i < size)
+		for (size_t i = ret.size(); i < size; ++i)
 		{
-			auto t = (IntTy)(dist(rng) + dist(rng));
-			if (uniq.count(t)) continue;
-			uniq.emplace(t);
-			ret[i++] = t;
+			ret.emplace_back(uniform ? (IntTy)dist(rng) : (IntTy)(dist(rng) + dist(rng)));
 		}
+		sort(ret.begin(), ret.end());
+		ret.erase(unique(ret.begin(), ret.end()), ret.end());
 	}
+	shuffle(ret.begin(), ret.end(), rng);
 	return ret;
 }
 
 template<class IntTy>
 vector<IntTy> rand_array(size_t size, bool uniform = true, size_t seed = 42)
 {
-	using SIntTy = typename conditional<sizeof(IntTy) == 1, int16_t, IntTy>::type;
 	vector<IntTy> ret(size);
 	mt19937_64 rng{ seed };
 
+	auto dist = key_dist<IntTy>(uniform);
 	if (uniform)
 	{
-		uniform_int_distribution<SIntTy> dist{ numeric_limits<IntTy>::min(), numeric_limits<IntTy>::max() };
 		for(auto& r : ret) r = (IntTy)dist(rng);
 	}
 	else
 	{
-		uniform_int_distribution<SIntTy> dist{ numeric_limits<IntTy>::min() / 2, numeric_limits<IntTy>::max() / 2 + numeric_limits<IntTy>::max() / 4 };
 		for (auto& r : ret) r = (IntTy)(dist(rng) + dist(rng));
 	}
 	return ret;
@@ -84,22 +116,7 @@ struct ReferenceSearcher
 	template<class KeyTy, class ValueTy>
 	void prepare(KeyTy* keys, ValueTy* values, size_t size)
 	{
-		vector<size_t> idx(size);
-		iota(idx.begin(), idx.end(), 0);
-
-		sort(idx.begin(), idx.end(), [&](size_t a, size_t b)
-		{
-			return keys[a] < keys[b];
-		});
-
-		vector<KeyTy> temp_keys{ keys, keys + size };
-		vector<ValueTy> temp_values{ values, values + size };
-
-		for (size_t i = 0; i < size; ++i)
-		{
-			keys[i] = temp_keys[idx[i]];
-			values[i] = temp_values[idx[i]];
-		}
+		sort_pairs(keys, values, size);
 	}
 
 	template<class KeyTy, class ValueTy>
@@ -112,6 +129,26 @@ struct ReferenceSearcher
 		found = values[it - keys];
 		return true;
 	}
+
+	// sorted-order index of the key selected by kind (size if there is none), found gets its value
+	template<bound_kind kind, class KeyTy, class ValueTy>
+	size_t bound(const KeyTy* keys, const ValueTy* values, size_t size, KeyTy target, ValueTy& found)
+	{
+		size_t idx = (kind == bound_kind::lower ? lower_bound(keys, keys + size, target) : upper_bound(keys, keys + size, target)) - keys;
+		if (kind == bound_kind::predecessor) idx = idx ? idx - 1 : size;
+		if (idx == size) return size;
+		found = values[idx];
+		return idx;
+	}
+
+	// calls callback(key, value) for every key in [lo, hi] in ascending order
+	template<class KeyTy, class ValueTy, class Callback>
+	size_t scan(const KeyTy* keys, const ValueTy* values, size_t size, KeyTy lo, KeyTy hi, Callback&& callback)
+	{
+		size_t i = lower_bound(keys, keys + size, lo) - keys, count = 0;
+		for (; i < size && !(hi < keys[i]); ++i, ++count) callback(keys[i], values[i]);
+		return count;
+	}
 };
 
 struct BalancedBinarySearcher : public ReferenceSearcher
@@ -155,26 +192,61 @@ struct BSTSearcher
 	template<class KeyTy, class ValueTy>
 	void prepare(KeyTy* keys, ValueTy* values, size_t size)
 	{
-		vector<size_t> idx = bst_order(keys, size);
+		bst_arrange(keys, values, size);
+	}
 
-		vector<KeyTy> temp_keys{ keys, keys + size };
-		vector<ValueTy> temp_values{ values, values + size };
+	template<class KeyTy, class ValueTy>
+	bool search(const KeyTy* keys, const ValueTy* values, size_t size, KeyTy target, ValueTy& found)
+	{
+		size_t idx;
+		if (!bst_search(keys, size, target, idx)) return false;
+		found = values[idx];
+		return true;
+	}
 
-		for (size_t i = 0; i < size; ++i)
-		{
-			keys[i] = temp_keys[idx[i]];
-			values[i] = temp_values[idx[i]];
-		}
+	template<bound_kind kind, class KeyTy, class ValueTy>
+	size_t bound(const KeyTy* keys, const ValueTy* values, size_t size, KeyTy target, ValueTy& found)
+	{
+		size_t idx = nst_bound<2, kind>(keys, size, target);
+		if (idx == size) return size;
+		found = values[idx];
+		return bst_rank(idx, size);
+	}
+
+	template<class KeyTy, class ValueTy>
+	nst_iterator<2, KeyTy, ValueTy> seek(const KeyTy* keys, const ValueTy* values, size_t size, KeyTy target)
+	{
+		return nst_seek<2>(keys, values, size, target);
+	}
+
+	template<class KeyTy, class ValueTy, class Callback>
+	size_t scan(const KeyTy* keys, const ValueTy* values, size_t size, KeyTy lo, KeyTy hi, Callback&& callback)
+	{
+		return nst_scan<2>(keys, values, size, lo, hi, callback);
 	}
+};
+
+struct EytzingerSearcher : public BSTSearcher
+{
+	static constexpr auto _name = ss::from_literal("Eytzinger Branchless");
 
 	template<class KeyTy, class ValueTy>
 	bool search(const KeyTy* keys, const ValueTy* values, size_t size, KeyTy target, ValueTy& found)
 	{
 		size_t idx;
-		if (!bst_search(keys, size, target, idx)) return false;
+		if (!eytzinger_search(keys, size, target, idx)) return false;
 		found = values[idx];
 		return true;
 	}
+
+	template<bound_kind kind, class KeyTy, class ValueTy>
+	size_t bound(const KeyTy* keys, const ValueTy* values, size_t size, KeyTy target, ValueTy& found)
+	{
+		size_t idx = eytzinger_bound<kind>(keys, size, target);
+		if (idx == size) return size;
+		found = values[idx];
+		return bst_rank(idx, size);
+	}
 };
 
 template<size_t n>
@@ -191,16 +263,7 @@ struct NSTSearcher
 	template<class KeyTy, class ValueTy>
 	void prepare(KeyTy* keys, ValueTy* values, size_t size)
 	{
-		vector<size_t> idx = nst_order<n>(keys, size);
-
-		vector<KeyTy> temp_keys{ keys, keys + size };
-		vector<ValueTy> temp_values{ values, values + size };
-
-		for (size_t i = 0; i < size; ++i)
-		{
-			keys[i] = temp_keys[idx[i]];
-			values[i] = temp_values[idx[i]];
-		}
+		nst_arrange<n>(keys, values, size);
 	}
 
 	template<class KeyTy, class ValueTy>
@@ -211,6 +274,27 @@ struct NSTSearcher
 		found = values[idx];
 		return true;
 	}
+
+	template<bound_kind kind, class KeyTy, class ValueTy>
+	size_t bound(const KeyTy* keys, const ValueTy* values, size_t size, KeyTy target, ValueTy& found)
+	{
+		size_t idx = nst_bound<n, kind>(keys, size, target);
+		if (idx == size) return size;
+		found = values[idx];
+		return nst_rank<n>(idx, size);
+	}
+
+	template<class KeyTy, class ValueTy>
+	nst_iterator<n, KeyTy, ValueTy> seek(const KeyTy* keys, const ValueTy* values, size_t size, KeyTy target)
+	{
+		return nst_seek<n>(keys, values, size, target);
+	}
+
+	template<class KeyTy, class ValueTy, class Callback>
+	size_t scan(const KeyTy* keys, const ValueTy* values, size_t size, KeyTy lo, KeyTy hi, Callback&& callback)
+	{
+		return nst_scan<n>(keys, values, size, lo, hi, callback);
+	}
 };
 
 template<size_t n>
@@ -228,323 +312,1094 @@ struct MixedNSTSearcher : public NSTSearcher<n>
 	}
 };
 
-
-#if defined(__SSE2__) || defined(__AVX2__)
-struct SSE2BBSearcher : public ReferenceSearcher
+template<size_t G>
+struct GroupBBSearcher : public ReferenceSearcher
 {
-	static constexpr auto _name = ss::from_literal("SSE2 BalancedBin.");
+	static constexpr auto _name = ss::from_literal("BalancedBin. Group(") + ss::num_to_string<G>::value + ss::from_literal(")");
 
 	template<class KeyTy, class ValueTy>
 	bool search(const KeyTy* keys, const ValueTy* values, size_t size, KeyTy target, ValueTy& found)
 	{
 		size_t idx;
-		if (!balanced_binary_search_sse2<false>(keys, size, target, idx)) return false;
+		if (!balanced_binary_search<true>(keys, size, target, idx)) return false;
 		found = values[idx];
 		return true;
 	}
+
+	template<class KeyTy, class ValueTy>
+	void search_batch(const KeyTy* keys, const ValueTy* values, size_t size, const KeyTy* targets, size_t n_targets, ValueTy* out, uint8_t* found)
+	{
+		balanced_binary_search_group(keys, values, size, targets, n_targets, out, found, G);
+	}
 };
 
-struct SSE2BBPrefetchSearcher : public ReferenceSearcher
+template<size_t G>
+struct AMACBSTSearcher : public BSTSearcher
 {
-	static constexpr auto _name = ss::from_literal("SSE2 BalancedBin. Pref.");
+	static constexpr auto _name = ss::from_literal("BinarySearchTree AMAC(") + ss::num_to_string<G>::value + ss::from_literal(")");
 
 	template<class KeyTy, class ValueTy>
-	bool search(const KeyTy* keys, const ValueTy* values, size_t size, KeyTy target, ValueTy& found)
+	void search_batch(const KeyTy* keys, const ValueTy* values, size_t size, const KeyTy* targets, size_t n_targets, ValueTy* out, uint8_t* found)
 	{
-		size_t idx;
-		if (!balanced_binary_search_sse2<true>(keys, size, target, idx)) return false;
-		found = values[idx];
-		return true;
+		bst_search_amac(keys, values, size, targets, n_targets, out, found, G);
 	}
 };
 
-template<size_t n>
-struct SSE2NSTSearcher
+template<size_t n, size_t G>
+struct AMACNSTSearcher : public NSTSearcher<n>
 {
-	static constexpr auto _name = ss::from_literal("SSE2 ") + ss::num_to_string<n>::value + ss::from_literal("-ary SearchTree");
+	static constexpr auto _name = ss::num_to_string<n>::value + ss::from_literal("-ary ST AMAC(") + ss::num_to_string<G>::value + ss::from_literal(")");
 
-	template<class IntTy>
-	constexpr bool is_valid() const
+	template<class KeyTy, class ValueTy>
+	void search_batch(const KeyTy* keys, const ValueTy* values, size_t size, const KeyTy* targets, size_t n_targets, ValueTy* out, uint8_t* found)
 	{
-		return n - 1 >= 16 / sizeof(IntTy);
+		nst_search_amac<n>(keys, values, size, targets, n_targets, out, found, G);
 	}
+};
+
+
+// sorts the keys like ReferenceSearcher, after mapping them onto signed keys for the SIMD kernels
+struct OrderedReferenceSearcher : public ReferenceSearcher
+{
+	ordered_key_storage ordered;
 
 	template<class KeyTy, class ValueTy>
 	void prepare(KeyTy* keys, ValueTy* values, size_t size)
 	{
-		vector<size_t> idx = nst_order<n>(keys, size);
-
-		vector<KeyTy> temp_keys{ keys, keys + size };
-		vector<ValueTy> temp_values{ values, values + size };
+		ReferenceSearcher::prepare(ordered.assign(keys, size), values, size);
+	}
 
-		for (size_t i = 0; i < size; ++i)
-		{
-			keys[i] = temp_keys[idx[i]];
-			values[i] = temp_values[idx[i]];
-		}
+	template<bound_kind kind, class KeyTy, class ValueTy>
+	size_t bound(const KeyTy* keys, const ValueTy* values, size_t size, KeyTy target, ValueTy& found)
+	{
+		return ReferenceSearcher::bound<kind>(ordered.get(keys), values, size, to_ordered(target), found);
 	}
+};
+
+struct DispatchBBSearcher : public OrderedReferenceSearcher
+{
+	static constexpr auto _name = ss::from_literal("Dispatch BalancedBin.");
 
 	template<class KeyTy, class ValueTy>
 	bool search(const KeyTy* keys, const ValueTy* values, size_t size, KeyTy target, ValueTy& found)
 	{
 		size_t idx;
-		if (!nst_search_sse2<n>(keys, size, target, idx)) return false;
+		if (!balanced_binary_search_dispatched<false, ordered_key_t<KeyTy>>(ordered.get(keys), size, to_ordered(target), idx)) return false;
 		found = values[idx];
 		return true;
 	}
 };
 
 template<size_t n>
-struct SSE2NSTSearcher2 : public SSE2NSTSearcher<n>
+struct DispatchNSTSearcher : public NSTSearcher<n>
 {
-	static constexpr auto _name = ss::from_literal("SSE2 ") + ss::num_to_string<n>::value + ss::from_literal("-ary ST (type2)");
+	static constexpr auto _name = ss::from_literal("Dispatch ") + ss::num_to_string<n>::value + ss::from_literal("-ary SearchTree");
+
+	ordered_key_storage ordered;
+
+	template<class KeyTy, class ValueTy>
+	void prepare(KeyTy* keys, ValueTy* values, size_t size)
+	{
+		NSTSearcher<n>::prepare(ordered.assign(keys, size), values, size);
+	}
 
 	template<class KeyTy, class ValueTy>
 	bool search(const KeyTy* keys, const ValueTy* values, size_t size, KeyTy target, ValueTy& found)
 	{
 		size_t idx;
-		if (!nst2_search_sse2<n>(keys, size, target, idx)) return false;
+		if (!nst_search_dispatched<n, ordered_key_t<KeyTy>>(ordered.get(keys), size, to_ordered(target), idx)) return false;
 		found = values[idx];
 		return true;
 	}
-};
-#endif
 
+	template<bound_kind kind, class KeyTy, class ValueTy>
+	size_t bound(const KeyTy* keys, const ValueTy* values, size_t size, KeyTy target, ValueTy& found)
+	{
+		size_t idx = nst_bound<n, kind>(ordered.get(keys), size, to_ordered(target));
+		if (idx == size) return size;
+		found = values[idx];
+		return nst_rank<n>(idx, size);
+	}
+};
 
-#if defined(__AVX2__)
-struct AVX2BBSearcher : public ReferenceSearcher
+template<size_t n>
+struct DispatchNSTSearcher2 : public DispatchNSTSearcher<n>
 {
-	static constexpr auto _name = ss::from_literal("AVX2 BalancedBin.");
+	static constexpr auto _name = ss::from_literal("Dispatch ") + ss::num_to_string<n>::value + ss::from_literal("-ary ST (type2)");
 
 	template<class KeyTy, class ValueTy>
 	bool search(const KeyTy* keys, const ValueTy* values, size_t size, KeyTy target, ValueTy& found)
 	{
 		size_t idx;
-		if (!balanced_binary_search_avx2<false>(keys, size, target, idx)) return false;
+		if (!nst2_search_dispatched<n, ordered_key_t<KeyTy>>(this->ordered.get(keys), size, to_ordered(target), idx)) return false;
 		found = values[idx];
 		return true;
 	}
 };
 
-struct AVX2BBPrefetchSearcher : public ReferenceSearcher
+// two-stage RMI over the sorted keys, the error window is searched with a balanced binary search
+struct LearnedSearcher : public OrderedReferenceSearcher
 {
-	static constexpr auto _name = ss::from_literal("AVX2 BalancedBin. Pref.");
+	static constexpr auto _name = ss::from_literal("Learned (RMI)");
+
+	learned_index index;
+
+	template<class KeyTy, class ValueTy>
+	void prepare(KeyTy* keys, ValueTy* values, size_t size)
+	{
+		OrderedReferenceSearcher::prepare(keys, values, size);
+		index.build(ordered.get(keys), size);
+	}
 
 	template<class KeyTy, class ValueTy>
 	bool search(const KeyTy* keys, const ValueTy* values, size_t size, KeyTy target, ValueTy& found)
 	{
 		size_t idx;
-		if (!balanced_binary_search_avx2<true>(keys, size, target, idx)) return false;
+		if (!learned_search(index, ordered.get(keys), size, to_ordered(target), idx)) return false;
 		found = values[idx];
 		return true;
 	}
 };
 
-template<size_t n>
-struct AVX2NSTSearcher
+// radix directory over the high key bits, the bucket is searched with a balanced binary search
+struct RadixSearcher : public OrderedReferenceSearcher
 {
-	static constexpr auto _name = ss::from_literal("AVX2 ") + ss::num_to_string<n>::value + ss::from_literal("-ary SearchTree");
+	static constexpr auto _name = ss::from_literal("Radix Dir. BalancedBin.");
 
-	template<class IntTy>
-	constexpr bool is_valid() const
-	{
-		return n - 1 >= 32 / sizeof(IntTy);
-	}
+	radix_directory directory;
 
 	template<class KeyTy, class ValueTy>
 	void prepare(KeyTy* keys, ValueTy* values, size_t size)
 	{
-		vector<size_t> idx = nst_order<n>(keys, size);
-
-		vector<KeyTy> temp_keys{ keys, keys + size };
-		vector<ValueTy> temp_values{ values, values + size };
-
-		for (size_t i = 0; i < size; ++i)
-		{
-			keys[i] = temp_keys[idx[i]];
-			values[i] = temp_values[idx[i]];
-		}
+		OrderedReferenceSearcher::prepare(keys, values, size);
+		directory.build(ordered.get(keys), size);
 	}
 
 	template<class KeyTy, class ValueTy>
 	bool search(const KeyTy* keys, const ValueTy* values, size_t size, KeyTy target, ValueTy& found)
 	{
 		size_t idx;
-		if (!nst_search_avx2<n>(keys, size, target, idx)) return false;
+		if (!radix_search(directory, ordered.get(keys), size, to_ordered(target), idx)) return false;
 		found = values[idx];
 		return true;
 	}
 };
 
-template<size_t n>
-struct AVX2NSTSearcher2 : public AVX2NSTSearcher<n>
+// frame-of-reference compressed k-ary tree, nodes that do not compress are searched in the plain layout
+struct FORSearcher
 {
-	static constexpr auto _name = ss::from_literal("AVX2 ") + ss::num_to_string<n>::value + ss::from_literal("-ary ST (type2)");
+	static constexpr auto _name = ss::from_literal("FOR16 SearchTree");
+
+	ordered_key_storage ordered;
+	aligned_buffer storage;
+
+	template<class IntTy>
+	constexpr bool is_valid() const
+	{
+		return sizeof(IntTy) == 4 || sizeof(IntTy) == 8;
+	}
+
+	template<class KeyTy, class ValueTy>
+	void prepare(KeyTy* keys, ValueTy* values, size_t size)
+	{
+		using OKeyTy = ordered_key_t<KeyTy>;
+		OKeyTy* okeys = ordered.assign(keys, size);
+		nst_arrange<for_fanout<OKeyTy>()>(okeys, values, size);
+		storage.allocate(for_tree_bytes<OKeyTy>(size));
+		for_compress(okeys, size, storage.data<uint8_t>());
+	}
 
 	template<class KeyTy, class ValueTy>
 	bool search(const KeyTy* keys, const ValueTy* values, size_t size, KeyTy target, ValueTy& found)
 	{
 		size_t idx;
-		if (!nst2_search_avx2<n>(keys, size, target, idx)) return false;
+		if (!nst_search_for(storage.data<uint8_t>(), ordered.get(keys), size, to_ordered(target), idx)) return false;
 		found = values[idx];
 		return true;
 	}
 };
-#endif
-
-#if defined(__ARM_NEON__) || defined(__ARM_NEON)
 
-struct NeonSTSearcher
+// B+-tree over the sorted keys whose inner nodes hold separators truncated to SepTy
+template<class SepTy>
+struct TruncatedSearcher
 {
-	static constexpr auto _name = ss::from_literal("Neon SearchTree");
+	static constexpr auto _name = ss::num_to_string<sizeof(SepTy) * 8>::value + ss::from_literal("-bit Trunc. B+Tree");
+
+	ordered_key_storage ordered;
+	truncated_tree tree;
 
 	template<class IntTy>
 	constexpr bool is_valid() const
 	{
-		return true;
+		return sizeof(IntTy) == 4 || sizeof(IntTy) == 8;
 	}
 
 	template<class KeyTy, class ValueTy>
 	void prepare(KeyTy* keys, ValueTy* values, size_t size)
 	{
-		static constexpr size_t n = 16 / sizeof(KeyTy) + 1;
-		vector<size_t> idx = nst_order<n>(keys, size);
-
-		vector<KeyTy> temp_keys{ keys, keys + size };
-		vector<ValueTy> temp_values{ values, values + size };
-
-		for (size_t i = 0; i < size; ++i)
-		{
-			keys[i] = temp_keys[idx[i]];
-			values[i] = temp_values[idx[i]];
-		}
+		auto* okeys = ordered.assign(keys, size);
+		sort_pairs(okeys, values, size);
+		truncated_tree_build<SepTy>(tree, okeys, size);
 	}
 
 	template<class KeyTy, class ValueTy>
 	bool search(const KeyTy* keys, const ValueTy* values, size_t size, KeyTy target, ValueTy& found)
 	{
-		static constexpr size_t n = 16 / sizeof(KeyTy) + 1;
 		size_t idx;
-		if (!nst_search_neon<n>(keys, size, target, idx)) return false;
+		if (!truncated_tree_search<SepTy>(tree, ordered.get(keys), size, to_ordered(target), idx)) return false;
 		found = values[idx];
 		return true;
 	}
 };
 
-struct NeonST2Searcher : public NeonSTSearcher
+struct SIPSearcher : public OrderedReferenceSearcher
 {
-	static constexpr auto _name = ss::from_literal("Neon SearchTree (type2)");
+	static constexpr auto _name = ss::from_literal("Interpolation-Seq. (SIP)");
 
 	template<class KeyTy, class ValueTy>
 	bool search(const KeyTy* keys, const ValueTy* values, size_t size, KeyTy target, ValueTy& found)
 	{
-		static constexpr size_t n = 16 / sizeof(KeyTy) + 1;
 		size_t idx;
-		if (!nst2_search_neon<n>(keys, size, target, idx)) return false;
+		if (!sip_search(ordered.get(keys), size, to_ordered(target), idx)) return false;
 		found = values[idx];
 		return true;
 	}
 };
-#endif
 
-template<class KeyTy, class Searcher>
-pair<vector<size_t>, double> benchmark(Searcher&& searcher, size_t size, bool uniform, size_t sample_size, double hit_rate = 0.5)
+struct TIPSearcher : public OrderedReferenceSearcher
 {
-	auto keys = unique_rand_array<KeyTy>(size, uniform);
-	auto values = vector<size_t>(size);
-	iota(values.begin(), values.end(), 0);
+	static constexpr auto _name = ss::from_literal("Three-Point Interp. (TIP)");
 
-	const size_t target_size = 8192;
-	auto targets = rand_array<KeyTy>(target_size, true, 777);
-	for (size_t i = (size_t)(target_size * hit_rate); i < target_size; ++i)
+	template<class KeyTy, class ValueTy>
+	bool search(const KeyTy* keys, const ValueTy* values, size_t size, KeyTy target, ValueTy& found)
 	{
-		targets[i] = keys[(size_t)targets[i] % size];
+		size_t idx;
+		if (!tip_search(ordered.get(keys), size, to_ordered(target), idx)) return false;
+		found = values[idx];
+		return true;
 	}
-	shuffle(targets.begin(), targets.end(), mt19937_64{});
-
-	auto results = vector<size_t>(target_size, size);
+};
 
-	searcher.prepare(keys.data(), values.data(), size);
+// buffered_nst with a standing delta: every 16th key of the first 1024 strides is inserted after the build, the key in the middle of each stride is erased and inserted again
+template<size_t n>
+struct BufferedNSTSearcher : public OrderedReferenceSearcher
+{
+	static constexpr auto _name = ss::from_literal("Buffered ") + ss::num_to_string<n>::value + ss::from_literal("-ary ST");
 
-	chrono::high_resolution_clock::time_point start_time = chrono::high_resolution_clock::now();
+	// the key and value types are only known in prepare
+	shared_ptr<void> index;
 
-	for (size_t i = 0; i < sample_size; ++i)
+	template<class KeyTy, class ValueTy>
+	void prepare(KeyTy* keys, ValueTy* values, size_t size)
 	{
-		searcher.search(keys.data(), values.data(), size, targets[i % target_size], results[i % target_size]);
-	}
-	chrono::high_resolution_clock::time_point end_time = chrono::high_resolution_clock::now();
-	double elapsed = chrono::duration<double, std::milli>{ end_time - start_time }.count();
-	return make_pair(move(results), elapsed);
-}
+		using OKeyTy = ordered_key_t<KeyTy>;
+		OrderedReferenceSearcher::prepare(keys, values, size);
+		const OKeyTy* okeys = ordered.get(keys);
+
+		static constexpr size_t stride = 16;
+		const size_t held = min(size / stride, (size_t)1024);
+		page_vector<OKeyTy> main_keys;
+		page_vector<ValueTy> main_values;
+		main_keys.reserve(size);
+		main_values.reserve(size);
+		for (size_t i = 0; i < size; ++i)
+		{
+			if (i % stride == 0 && i / stride < held) continue;
+			main_keys.push_back(okeys[i]);
+			main_values.push_back(values[i]);
+		}
 
-template<class KeyTy>
-pair<vector<size_t>, double> benchmark_hash(size_t size, bool uniform, size_t sample_size, double hit_rate = 0.5)
-{
-	auto keys = unique_rand_array<KeyTy>(size, uniform);
-	
-	unordered_map<KeyTy, size_t> hash;
-	for (size_t i = 0; i < size; ++i)
-	{
-		hash.emplace(keys[i], i);
+		auto buffered = make_shared<buffered_nst<n, OKeyTy, ValueTy>>();
+		buffered->build(main_keys.data(), main_values.data(), main_keys.size());
+		for (size_t j = 0; j < held; ++j)
+		{
+			buffered->insert(okeys[j * stride], values[j * stride]);
+			const size_t i = j * stride + stride / 2;
+			buffered->erase(okeys[i]);
+			buffered->insert(okeys[i], values[i]);
+		}
+		index = buffered;
 	}
 
-	const size_t target_size = 8192;
-	auto targets = rand_array<KeyTy>(target_size, true, 777);
-	for (size_t i = (size_t)(target_size * hit_rate); i < target_size; ++i)
+	template<class KeyTy, class ValueTy>
+	bool search(const KeyTy*, const ValueTy*, size_t, KeyTy target, ValueTy& found)
 	{
-		targets[i] = keys[(size_t)targets[i] % size];
+		return static_cast<const buffered_nst<n, ordered_key_t<KeyTy>, ValueTy>*>(index.get())->search(to_ordered(target), found);
 	}
-	shuffle(targets.begin(), targets.end(), mt19937_64{});
+};
 
-	auto results = vector<size_t>(target_size, size);
+// snapshot_index reader over its own copy of the keys, which prepare replaces once while a reader is inside; readers enter again every reader_batch lookups
+template<size_t n>
+struct SnapshotNSTSearcher : public OrderedReferenceSearcher
+{
+	static constexpr auto _name = ss::from_literal("Snapshot ") + ss::num_to_string<n>::value + ss::from_literal("-ary ST");
+	static constexpr size_t reader_batch = 256;
 
-	chrono::high_resolution_clock::time_point start_time = chrono::high_resolution_clock::now();
+	template<class KeyTy, class ValueTy>
+	using index_type = snapshot_index<nst_snapshot<n, KeyTy, ValueTy>>;
 
-	for (size_t i = 0; i < sample_size; ++i)
+	// a reader of the index, search() takes the key types of the benchmark
+	template<class KeyTy, class ValueTy>
+	struct view
 	{
-		auto it = hash.find(targets[i % target_size]);
-		results[i % target_size] = it == hash.end() ? size : it->second;
-	}
-	chrono::high_resolution_clock::time_point end_time = chrono::high_resolution_clock::now();
-	double elapsed = chrono::duration<double, std::milli>{ end_time - start_time }.count();
-	return make_pair(move(results), elapsed);
-}
+		shared_ptr<index_type<ordered_key_t<KeyTy>, ValueTy>> index;
+		typename index_type<ordered_key_t<KeyTy>, ValueTy>::reader reader{ index->register_reader() };
+		const nst_snapshot<n, ordered_key_t<KeyTy>, ValueTy>* snapshot = reader.enter();
+		size_t lookups = 0;
 
-template<class KeyTy>
-void run_benchmark_partial(const vector<size_t>& ref, double* accum, double* accum_sq, size_t size, bool uniform, size_t sample_size)
-{
-}
+		view(shared_ptr<index_type<ordered_key_t<KeyTy>, ValueTy>> _index)
+			: index{ move(_index) }
+		{
+		}
 
-template<class KeyTy, class First, class... Rest>
-void run_benchmark_partial(const vector<size_t>& ref, double* accum, double* accum_sq, size_t size, bool uniform, size_t sample_size)
-{
-	if (First{}.template is_valid<KeyTy>())
-	{
-		auto r = benchmark<KeyTy>(First{}, size, uniform, sample_size);
-		if (ref != r.first)
+		bool search(const KeyTy*, const ValueTy*, size_t, KeyTy target, ValueTy& found)
 		{
-			printf("    %s yields a wrong result!\n", First::_name.c_str());
+			if (++lookups % reader_batch == 0)
+			{
+				reader.leave();
+				snapshot = reader.enter();
+			}
+			return snapshot->search(to_ordered(target), found);
 		}
-		*accum += r.second;
-		*accum_sq += r.second * r.second;
-	}
-	run_benchmark_partial<KeyTy, Rest...>(ref, accum + 1, accum_sq + 1, size, uniform, sample_size);
-}
+	};
 
+	// the key and value types are only known in prepare, the view is the reader of the calling thread
+	shared_ptr<void> own_view;
 
-template<class KeyTy, class... Searchers>
-void run_benchmark_set(tuple<Searchers...>, size_t size, bool uniform, size_t sample_size, size_t repeat = 10)
-{
-	vector<double> accum(sizeof ... (Searchers) + 2), accum_sq(sizeof ... (Searchers) + 2);
-	for (size_t i = 0; i < repeat; ++i)
+	template<class KeyTy, class ValueTy>
+	void prepare(KeyTy* keys, ValueTy* values, size_t size)
 	{
-		auto ref_result = benchmark<KeyTy>(ReferenceSearcher{}, size, uniform, sample_size);
-		accum[0] += ref_result.second;
+		using OKeyTy = ordered_key_t<KeyTy>;
+		using snapshot_type = nst_snapshot<n, OKeyTy, ValueTy>;
+		const OKeyTy* okeys = ordered.assign(keys, size);
+
+		auto index = make_shared<index_type<OKeyTy, ValueTy>>();
+		index->publish(make_unique<snapshot_type>(okeys, values, size));
+		{
+			auto reader = index->register_reader();
+			reader.enter();
+			index->publish(make_unique<snapshot_type>(okeys, values, size));
+			reader.leave();
+		}
+		index->synchronize();
+		own_view = make_shared<view<KeyTy, ValueTy>>(index);
+	}
+
+	template<class KeyTy, class ValueTy>
+	bool search(const KeyTy* keys, const ValueTy* values, size_t size, KeyTy target, ValueTy& found)
+	{
+		return static_cast<view<KeyTy, ValueTy>*>(own_view.get())->search(keys, values, size, target, found);
+	}
+
+	// a reader of its own for every thread of the throughput benchmark
+	template<class KeyTy, class ValueTy>
+	view<KeyTy, ValueTy> thread_view()
+	{
+		return view<KeyTy, ValueTy>{ static_cast<view<KeyTy, ValueTy>*>(own_view.get())->index };
+	}
+};
+
+#if defined(__SSE2__) || defined(__AVX2__)
+struct SSE2BBSearcher : public OrderedReferenceSearcher
+{
+	static constexpr auto _name = ss::from_literal("SSE2 BalancedBin.");
+
+	template<class KeyTy, class ValueTy>
+	bool search(const KeyTy* keys, const ValueTy* values, size_t size, KeyTy target, ValueTy& found)
+	{
+		size_t idx;
+		if (!balanced_binary_search_sse2<false>(ordered.get(keys), size, to_ordered(target), idx)) return false;
+		found = values[idx];
+		return true;
+	}
+};
+
+struct SSE2BBPrefetchSearcher : public OrderedReferenceSearcher
+{
+	static constexpr auto _name = ss::from_literal("SSE2 BalancedBin. Pref.");
+
+	template<class KeyTy, class ValueTy>
+	bool search(const KeyTy* keys, const ValueTy* values, size_t size, KeyTy target, ValueTy& found)
+	{
+		size_t idx;
+		if (!balanced_binary_search_sse2<true>(ordered.get(keys), size, to_ordered(target), idx)) return false;
+		found = values[idx];
+		return true;
+	}
+};
+
+template<size_t n>
+struct SSE2NSTSearcher
+{
+	static constexpr auto _name = ss::from_literal("SSE2 ") + ss::num_to_string<n>::value + ss::from_literal("-ary SearchTree");
+
+	ordered_key_storage ordered;
+
+	template<class IntTy>
+	constexpr bool is_valid() const
+	{
+		return n - 1 >= 16 / sizeof(IntTy) && n - 1 <= 64 / sizeof(IntTy);
+	}
+
+	template<class KeyTy, class ValueTy>
+	void prepare(KeyTy* keys, ValueTy* values, size_t size)
+	{
+		nst_arrange<n>(ordered.assign(keys, size), values, size);
+	}
+
+	template<class KeyTy, class ValueTy>
+	bool search(const KeyTy* keys, const ValueTy* values, size_t size, KeyTy target, ValueTy& found)
+	{
+		size_t idx;
+		if (!nst_search_sse2<n>(ordered.get(keys), size, to_ordered(target), idx)) return false;
+		found = values[idx];
+		return true;
+	}
+
+	template<bound_kind kind, class KeyTy, class ValueTy>
+	size_t bound(const KeyTy* keys, const ValueTy* values, size_t size, KeyTy target, ValueTy& found)
+	{
+		size_t idx = nst_bound_sse2<n, kind>(ordered.get(keys), size, to_ordered(target));
+		if (idx == size) return size;
+		found = values[idx];
+		return nst_rank<n>(idx, size);
+	}
+};
+
+template<size_t n>
+struct SSE2NSTSearcher2 : public SSE2NSTSearcher<n>
+{
+	static constexpr auto _name = ss::from_literal("SSE2 ") + ss::num_to_string<n>::value + ss::from_literal("-ary ST (type2)");
+
+	template<class KeyTy, class ValueTy>
+	bool search(const KeyTy* keys, const ValueTy* values, size_t size, KeyTy target, ValueTy& found)
+	{
+		size_t idx;
+		if (!nst2_search_sse2<n>(this->ordered.get(keys), size, to_ordered(target), idx)) return false;
+		found = values[idx];
+		return true;
+	}
+};
+
+// name suffix of the padded searchers for each value_layout
+template<value_layout layout>
+struct ValueLayoutName
+{
+	static constexpr auto value = ss::from_literal(" (padded)");
+};
+
+template<>
+struct ValueLayoutName<value_layout::prefetched>
+{
+	static constexpr auto value = ss::from_literal(" (val. prefetch)");
+};
+
+template<>
+struct ValueLayoutName<value_layout::colocated>
+{
+	static constexpr auto value = ss::from_literal(" (co-located)");
+};
+
+// searches an aligned, sentinel-padded copy of the layout, layout selects where the value of a hit is read from
+template<size_t n, value_layout layout = value_layout::separate>
+struct SSE2NSTPaddedSearcher : public SSE2NSTSearcher<n>
+{
+	static constexpr auto _name = ss::from_literal("SSE2 ") + ss::num_to_string<n>::value + ss::from_literal("-ary ST") + ValueLayoutName<layout>::value;
+
+	aligned_buffer storage;
+
+	template<class KeyTy, class ValueTy>
+	void prepare(KeyTy* keys, ValueTy* values, size_t size)
+	{
+		SSE2NSTSearcher<n>::prepare(keys, values, size);
+		using OKeyTy = ordered_key_t<KeyTy>;
+		if constexpr (layout == value_layout::colocated)
+		{
+			storage.allocate(nst_colocated_bytes<n, OKeyTy, ValueTy>(size));
+			nst_colocate<n>(this->ordered.get(keys), values, size, storage.data<uint8_t>());
+		}
+		else
+		{
+			storage.allocate(nst_padded_size<n>(size) * sizeof(OKeyTy));
+			nst_pad<n>(this->ordered.get(keys), size, storage.data<OKeyTy>());
+		}
+	}
+
+	template<class KeyTy, class ValueTy>
+	bool search(const KeyTy*, const ValueTy* values, size_t size, KeyTy target, ValueTy& found)
+	{
+		size_t idx;
+		if constexpr (layout == value_layout::colocated)
+		{
+			ValueTy value;
+			if (!nst_search_colocated_sse2<n>(storage.data<uint8_t>(), nst_padded_size<n>(size), to_ordered(target), idx, value) || idx >= size) return false;
+			found = value;
+		}
+		else if constexpr (layout == value_layout::prefetched)
+		{
+			if (!nst_search_value_prefetch_sse2<n>(storage.data<ordered_key_t<KeyTy>>(), values, nst_padded_size<n>(size), to_ordered(target), idx) || idx >= size) return false;
+			found = values[idx];
+		}
+		else
+		{
+			if (!nst_search_padded_sse2<n>(storage.data<ordered_key_t<KeyTy>>(), nst_padded_size<n>(size), to_ordered(target), idx) || idx >= size) return false;
+			found = values[idx];
+		}
+		return true;
+	}
+};
+
+// nodes of the SSE2 n-ary tree grouped into subtrees that each fill one page
+template<size_t n>
+struct SSE2FASTSearcher : public SSE2NSTSearcher<n>
+{
+	static constexpr auto _name = ss::from_literal("SSE2 ") + ss::num_to_string<n>::value + ss::from_literal("-ary FAST");
+
+	fast_tree tree;
+
+	template<class KeyTy, class ValueTy>
+	void prepare(KeyTy* keys, ValueTy* values, size_t size)
+	{
+		SSE2NSTSearcher<n>::prepare(keys, values, size);
+		fast_tree_build<n>(tree, this->ordered.get(keys), size);
+	}
+
+	template<class KeyTy, class ValueTy>
+	bool search(const KeyTy*, const ValueTy* values, size_t size, KeyTy target, ValueTy& found)
+	{
+		size_t idx;
+		if (!fast_tree_search_sse2<n>(tree, size, to_ordered(target), idx)) return false;
+		found = values[idx];
+		return true;
+	}
+};
+#endif
+
+
+#if defined(__AVX2__)
+struct AVX2BBSearcher : public OrderedReferenceSearcher
+{
+	static constexpr auto _name = ss::from_literal("AVX2 BalancedBin.");
+
+	template<class KeyTy, class ValueTy>
+	bool search(const KeyTy* keys, const ValueTy* values, size_t size, KeyTy target, ValueTy& found)
+	{
+		size_t idx;
+		if (!balanced_binary_search_avx2<false>(ordered.get(keys), size, to_ordered(target), idx)) return false;
+		found = values[idx];
+		return true;
+	}
+};
+
+struct AVX2BBPrefetchSearcher : public OrderedReferenceSearcher
+{
+	static constexpr auto _name = ss::from_literal("AVX2 BalancedBin. Pref.");
+
+	template<class KeyTy, class ValueTy>
+	bool search(const KeyTy* keys, const ValueTy* values, size_t size, KeyTy target, ValueTy& found)
+	{
+		size_t idx;
+		if (!balanced_binary_search_avx2<true>(ordered.get(keys), size, to_ordered(target), idx)) return false;
+		found = values[idx];
+		return true;
+	}
+};
+
+template<size_t n>
+struct AVX2NSTSearcher
+{
+	static constexpr auto _name = ss::from_literal("AVX2 ") + ss::num_to_string<n>::value + ss::from_literal("-ary SearchTree");
+
+	ordered_key_storage ordered;
+
+	template<class IntTy>
+	constexpr bool is_valid() const
+	{
+		return n - 1 >= 32 / sizeof(IntTy) && n - 1 <= 64 / sizeof(IntTy);
+	}
+
+	template<class KeyTy, class ValueTy>
+	void prepare(KeyTy* keys, ValueTy* values, size_t size)
+	{
+		nst_arrange<n>(ordered.assign(keys, size), values, size);
+	}
+
+	template<class KeyTy, class ValueTy>
+	bool search(const KeyTy* keys, const ValueTy* values, size_t size, KeyTy target, ValueTy& found)
+	{
+		size_t idx;
+		if (!nst_search_avx2<n>(ordered.get(keys), size, to_ordered(target), idx)) return false;
+		found = values[idx];
+		return true;
+	}
+
+	template<bound_kind kind, class KeyTy, class ValueTy>
+	size_t bound(const KeyTy* keys, const ValueTy* values, size_t size, KeyTy target, ValueTy& found)
+	{
+		size_t idx = nst_bound_avx2<n, kind>(ordered.get(keys), size, to_ordered(target));
+		if (idx == size) return size;
+		found = values[idx];
+		return nst_rank<n>(idx, size);
+	}
+};
+
+template<size_t n>
+struct AVX2NSTSearcher2 : public AVX2NSTSearcher<n>
+{
+	static constexpr auto _name = ss::from_literal("AVX2 ") + ss::num_to_string<n>::value + ss::from_literal("-ary ST (type2)");
+
+	template<class KeyTy, class ValueTy>
+	bool search(const KeyTy* keys, const ValueTy* values, size_t size, KeyTy target, ValueTy& found)
+	{
+		size_t idx;
+		if (!nst2_search_avx2<n>(this->ordered.get(keys), size, to_ordered(target), idx)) return false;
+		found = values[idx];
+		return true;
+	}
+};
+
+// searches an aligned, sentinel-padded copy of the layout, layout selects where the value of a hit is read from
+template<size_t n, value_layout layout = value_layout::separate>
+struct AVX2NSTPaddedSearcher : public AVX2NSTSearcher<n>
+{
+	static constexpr auto _name = ss::from_literal("AVX2 ") + ss::num_to_string<n>::value + ss::from_literal("-ary ST") + ValueLayoutName<layout>::value;
+
+	aligned_buffer storage;
+
+	template<class KeyTy, class ValueTy>
+	void prepare(KeyTy* keys, ValueTy* values, size_t size)
+	{
+		AVX2NSTSearcher<n>::prepare(keys, values, size);
+		using OKeyTy = ordered_key_t<KeyTy>;
+		if constexpr (layout == value_layout::colocated)
+		{
+			storage.allocate(nst_colocated_bytes<n, OKeyTy, ValueTy>(size));
+			nst_colocate<n>(this->ordered.get(keys), values, size, storage.data<uint8_t>());
+		}
+		else
+		{
+			storage.allocate(nst_padded_size<n>(size) * sizeof(OKeyTy));
+			nst_pad<n>(this->ordered.get(keys), size, storage.data<OKeyTy>());
+		}
+	}
+
+	template<class KeyTy, class ValueTy>
+	bool search(const KeyTy*, const ValueTy* values, size_t size, KeyTy target, ValueTy& found)
+	{
+		size_t idx;
+		if constexpr (layout == value_layout::colocated)
+		{
+			ValueTy value;
+			if (!nst_search_colocated_avx2<n>(storage.data<uint8_t>(), nst_padded_size<n>(size), to_ordered(target), idx, value) || idx >= size) return false;
+			found = value;
+		}
+		else if constexpr (layout == value_layout::prefetched)
+		{
+			if (!nst_search_value_prefetch_avx2<n>(storage.data<ordered_key_t<KeyTy>>(), values, nst_padded_size<n>(size), to_ordered(target), idx) || idx >= size) return false;
+			found = values[idx];
+		}
+		else
+		{
+			if (!nst_search_padded_avx2<n>(storage.data<ordered_key_t<KeyTy>>(), nst_padded_size<n>(size), to_ordered(target), idx) || idx >= size) return false;
+			found = values[idx];
+		}
+		return true;
+	}
+};
+
+// nodes of the AVX2 n-ary tree grouped into subtrees that each fill one page
+template<size_t n>
+struct AVX2FASTSearcher : public AVX2NSTSearcher<n>
+{
+	static constexpr auto _name = ss::from_literal("AVX2 ") + ss::num_to_string<n>::value + ss::from_literal("-ary FAST");
+
+	fast_tree tree;
+
+	template<class KeyTy, class ValueTy>
+	void prepare(KeyTy* keys, ValueTy* values, size_t size)
+	{
+		AVX2NSTSearcher<n>::prepare(keys, values, size);
+		fast_tree_build<n>(tree, this->ordered.get(keys), size);
+	}
+
+	template<class KeyTy, class ValueTy>
+	bool search(const KeyTy*, const ValueTy* values, size_t size, KeyTy target, ValueTy& found)
+	{
+		size_t idx;
+		if (!fast_tree_search_avx2<n>(tree, size, to_ordered(target), idx)) return false;
+		found = values[idx];
+		return true;
+	}
+};
+
+// 64-byte nodes of 16-bit offsets from a base, 31-ary for 32-bit keys and 29-ary for 64-bit ones
+struct AVX2FORSearcher : public FORSearcher
+{
+	static constexpr auto _name = ss::from_literal("AVX2 FOR16 SearchTree");
+
+	template<class KeyTy, class ValueTy>
+	bool search(const KeyTy* keys, const ValueTy* values, size_t size, KeyTy target, ValueTy& found)
+	{
+		size_t idx;
+		if (!nst_search_for_avx2(storage.data<uint8_t>(), ordered.get(keys), size, to_ordered(target), idx)) return false;
+		found = values[idx];
+		return true;
+	}
+};
+
+template<class SepTy>
+struct AVX2TruncatedSearcher : public TruncatedSearcher<SepTy>
+{
+	static constexpr auto _name = ss::from_literal("AVX2 ") + ss::num_to_string<sizeof(SepTy) * 8>::value + ss::from_literal("-bit Trunc. B+Tree");
+
+	template<class KeyTy, class ValueTy>
+	bool search(const KeyTy* keys, const ValueTy* values, size_t size, KeyTy target, ValueTy& found)
+	{
+		size_t idx;
+		if (!truncated_tree_search_avx2<SepTy>(this->tree, this->ordered.get(keys), size, to_ordered(target), idx)) return false;
+		found = values[idx];
+		return true;
+	}
+};
+
+struct AVX2LearnedSearcher : public LearnedSearcher
+{
+	static constexpr auto _name = ss::from_literal("AVX2 Learned (RMI)");
+
+	template<class KeyTy, class ValueTy>
+	bool search(const KeyTy* keys, const ValueTy* values, size_t size, KeyTy target, ValueTy& found)
+	{
+		size_t idx;
+		if (!learned_search_avx2(index, ordered.get(keys), size, to_ordered(target), idx)) return false;
+		found = values[idx];
+		return true;
+	}
+};
+
+struct AVX2RadixSearcher : public RadixSearcher
+{
+	static constexpr auto _name = ss::from_literal("AVX2 Radix Dir. BalancedBin.");
+
+	template<class KeyTy, class ValueTy>
+	bool search(const KeyTy* keys, const ValueTy* values, size_t size, KeyTy target, ValueTy& found)
+	{
+		size_t idx;
+		if (!radix_search_avx2(directory, ordered.get(keys), size, to_ordered(target), idx)) return false;
+		found = values[idx];
+		return true;
+	}
+};
+
+struct AVX2SIPSearcher : public OrderedReferenceSearcher
+{
+	static constexpr auto _name = ss::from_literal("AVX2 SIP");
+
+	template<class KeyTy, class ValueTy>
+	bool search(const KeyTy* keys, const ValueTy* values, size_t size, KeyTy target, ValueTy& found)
+	{
+		size_t idx;
+		if (!sip_search_avx2(ordered.get(keys), size, to_ordered(target), idx)) return false;
+		found = values[idx];
+		return true;
+	}
+};
+
+struct AVX2TIPSearcher : public OrderedReferenceSearcher
+{
+	static constexpr auto _name = ss::from_literal("AVX2 TIP");
+
+	template<class KeyTy, class ValueTy>
+	bool search(const KeyTy* keys, const ValueTy* values, size_t size, KeyTy target, ValueTy& found)
+	{
+		size_t idx;
+		if (!tip_search_avx2(ordered.get(keys), size, to_ordered(target), idx)) return false;
+		found = values[idx];
+		return true;
+	}
+};
+
+struct AVX2BBBatchSearcher : public AVX2BBSearcher
+{
+	static constexpr auto _name = ss::from_literal("AVX2 BalancedBin. Batch");
+
+	// the gather kernels read the keys as they are, so they need keys that are already signed
+	template<class IntTy>
+	constexpr bool is_valid() const
+	{
+		return is_ordered_key<IntTy>::value;
+	}
+
+	template<class KeyTy, class ValueTy>
+	void search_batch(const KeyTy* keys, const ValueTy* values, size_t size, const KeyTy* targets, size_t n_targets, ValueTy* out, uint8_t* found)
+	{
+		balanced_binary_search_batch_avx2(keys, values, size, targets, n_targets, out, found);
+	}
+};
+
+template<size_t n>
+struct AVX2NSTBatchSearcher : public NSTSearcher<n>
+{
+	static constexpr auto _name = ss::from_literal("AVX2 ") + ss::num_to_string<n>::value + ss::from_literal("-ary ST Batch");
+
+	template<class KeyTy, class ValueTy>
+	void search_batch(const KeyTy* keys, const ValueTy* values, size_t size, const KeyTy* targets, size_t n_targets, ValueTy* out, uint8_t* found)
+	{
+		nst_search_batch_avx2<n>(keys, values, size, targets, n_targets, out, found);
+	}
+};
+#endif
+
+#if defined(__cpp_impl_coroutine)
+template<size_t N>
+struct CoroBBSearcher : public BalancedBinaryPrefetchSearcher
+{
+	static constexpr auto _name = ss::from_literal("BalancedBin. Coro(") + ss::num_to_string<N>::value + ss::from_literal(")");
+
+	template<class KeyTy, class ValueTy>
+	void search_batch(const KeyTy* keys, const ValueTy* values, size_t size, const KeyTy* targets, size_t n_targets, ValueTy* out, uint8_t* found)
+	{
+		auto sched = make_lookup_scheduler(N, [&](size_t j, size_t idx)
+		{
+			found[j] = idx != lookup_task::npos;
+			if (found[j]) out[j] = values[idx];
+		});
+		for (size_t j = 0; j < n_targets; ++j) sched.spawn(balanced_binary_search_coro(keys, size, targets[j]), j);
+		sched.drain();
+	}
+};
+
+template<size_t N>
+struct CoroBSTSearcher : public BSTSearcher
+{
+	static constexpr auto _name = ss::from_literal("BinarySearchTree Coro(") + ss::num_to_string<N>::value + ss::from_literal(")");
+
+	template<class KeyTy, class ValueTy>
+	void search_batch(const KeyTy* keys, const ValueTy* values, size_t size, const KeyTy* targets, size_t n_targets, ValueTy* out, uint8_t* found)
+	{
+		auto sched = make_lookup_scheduler(N, [&](size_t j, size_t idx)
+		{
+			found[j] = idx != lookup_task::npos;
+			if (found[j]) out[j] = values[idx];
+		});
+		for (size_t j = 0; j < n_targets; ++j) sched.spawn(bst_search_coro(keys, size, targets[j]), j);
+		sched.drain();
+	}
+};
+
+#if defined(__AVX2__)
+template<size_t n, size_t N>
+struct CoroAVX2NSTSearcher : public AVX2NSTSearcher<n>
+{
+	static constexpr auto _name = ss::from_literal("AVX2 ") + ss::num_to_string<n>::value + ss::from_literal("-ary ST Coro(") + ss::num_to_string<N>::value + ss::from_literal(")");
+
+	template<class IntTy>
+	constexpr bool is_valid() const
+	{
+		return AVX2NSTSearcher<n>::template is_valid<IntTy>() && is_ordered_key<IntTy>::value;
+	}
+
+	template<class KeyTy, class ValueTy>
+	void search_batch(const KeyTy* keys, const ValueTy* values, size_t size, const KeyTy* targets, size_t n_targets, ValueTy* out, uint8_t* found)
+	{
+		auto sched = make_lookup_scheduler(N, [&](size_t j, size_t idx)
+		{
+			found[j] = idx != lookup_task::npos;
+			if (found[j]) out[j] = values[idx];
+		});
+		for (size_t j = 0; j < n_targets; ++j) sched.spawn(nst_search_avx2_coro<n>(keys, size, targets[j]), j);
+		sched.drain();
+	}
+};
+#endif
+#endif
+
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+
+struct NeonSTSearcher
+{
+	static constexpr auto _name = ss::from_literal("Neon SearchTree");
+
+	ordered_key_storage ordered;
+
+	template<class IntTy>
+	constexpr bool is_valid() const
+	{
+		return true;
+	}
+
+	template<class KeyTy, class ValueTy>
+	void prepare(KeyTy* keys, ValueTy* values, size_t size)
+	{
+		static constexpr size_t n = 16 / sizeof(KeyTy) + 1;
+		nst_arrange<n>(ordered.assign(keys, size), values, size);
+	}
+
+	template<class KeyTy, class ValueTy>
+	bool search(const KeyTy* keys, const ValueTy* values, size_t size, KeyTy target, ValueTy& found)
+	{
+		static constexpr size_t n = 16 / sizeof(KeyTy) + 1;
+		size_t idx;
+		if (!nst_search_neon<n>(ordered.get(keys), size, to_ordered(target), idx)) return false;
+		found = values[idx];
+		return true;
+	}
+
+	template<bound_kind kind, class KeyTy, class ValueTy>
+	size_t bound(const KeyTy* keys, const ValueTy* values, size_t size, KeyTy target, ValueTy& found)
+	{
+		static constexpr size_t n = 16 / sizeof(KeyTy) + 1;
+		size_t idx = nst_bound<n, kind>(ordered.get(keys), size, to_ordered(target));
+		if (idx == size) return size;
+		found = values[idx];
+		return nst_rank<n>(idx, size);
+	}
+};
+
+struct NeonST2Searcher : public NeonSTSearcher
+{
+	static constexpr auto _name = ss::from_literal("Neon SearchTree (type2)");
+
+	template<class KeyTy, class ValueTy>
+	bool search(const KeyTy* keys, const ValueTy* values, size_t size, KeyTy target, ValueTy& found)
+	{
+		static constexpr size_t n = 16 / sizeof(KeyTy) + 1;
+		size_t idx;
+		if (!nst2_search_neon<n>(ordered.get(keys), size, to_ordered(target), idx)) return false;
+		found = values[idx];
+		return true;
+	}
+};
+#endif
+
+template<class Searcher, class KeyTy, class = void>
+struct has_search_batch : false_type {};
+
+template<class Searcher, class KeyTy>
+struct has_search_batch<Searcher, KeyTy, decltype(declval<Searcher&>().search_batch(
+	declval<const KeyTy*>(), declval<const size_t*>(), size_t{}, declval<const KeyTy*>(), size_t{}, declval<size_t*>(), declval<uint8_t*>()
+))> : true_type {};
+
+template<class Searcher, class KeyTy>
+void search_loop(Searcher& searcher, const page_vector<KeyTy>& keys, const page_vector<size_t>& values, const vector<KeyTy>& targets, vector<size_t>& results, size_t sample_size, false_type)
+{
+	const size_t target_size = targets.size();
+	for (size_t i = 0; i < sample_size; ++i)
+	{
+		searcher.search(keys.data(), values.data(), keys.size(), targets[i % target_size], results[i % target_size]);
+	}
+}
+
+template<class Searcher, class KeyTy>
+void search_loop(Searcher& searcher, const page_vector<KeyTy>& keys, const page_vector<size_t>& values, const vector<KeyTy>& targets, vector<size_t>& results, size_t sample_size, true_type)
+{
+	const size_t target_size = targets.size();
+	vector<uint8_t> found(target_size);
+	for (size_t i = 0; i < sample_size; i += target_size)
+	{
+		searcher.search_batch(keys.data(), values.data(), keys.size(), targets.data(), min(target_size, sample_size - i), results.data(), found.data());
+	}
+}
+
+template<class KeyTy>
+vector<KeyTy> make_targets(const vector<KeyTy>& keys, double hit_rate = 0.5, size_t seed = 777)
+{
+	const size_t target_size = 8192;
+	auto targets = rand_array<KeyTy>(target_size, true, seed);
+	for (size_t i = (size_t)(target_size * hit_rate); i < target_size; ++i)
+	{
+		targets[i] = keys[(size_t)(int64_t)targets[i] % keys.size()];
+	}
+	shuffle(targets.begin(), targets.end(), mt19937_64{});
+	return targets;
+}
+
+template<class KeyTy, class Searcher>
+pair<vector<size_t>, double> benchmark(Searcher&& searcher, const vector<KeyTy>& base_keys, const vector<KeyTy>& targets, size_t sample_size)
+{
+	const size_t size = base_keys.size();
+	page_vector<KeyTy> keys(base_keys.begin(), base_keys.end());
+	page_vector<size_t> values(size);
+	iota(values.begin(), values.end(), 0);
+
+	auto results = vector<size_t>(targets.size(), size);
+
+	searcher.prepare(keys.data(), values.data(), size);
+
+	chrono::high_resolution_clock::time_point start_time = chrono::high_resolution_clock::now();
+
+	search_loop(searcher, keys, values, targets, results, sample_size, has_search_batch<typename decay<Searcher>::type, KeyTy>{});
+
+	chrono::high_resolution_clock::time_point end_time = chrono::high_resolution_clock::now();
+	double elapsed = chrono::duration<double, std::milli>{ end_time - start_time }.count();
+	return make_pair(move(results), elapsed);
+}
+
+template<class KeyTy>
+pair<vector<size_t>, double> benchmark_hash(const vector<KeyTy>& keys, const vector<KeyTy>& targets, size_t sample_size)
+{
+	const size_t size = keys.size();
+	const size_t target_size = targets.size();
+
+	unordered_map<KeyTy, size_t> hash;
+	for (size_t i = 0; i < size; ++i)
+	{
+		hash.emplace(keys[i], i);
+	}
+
+	auto results = vector<size_t>(target_size, size);
+
+	chrono::high_resolution_clock::time_point start_time = chrono::high_resolution_clock::now();
+
+	for (size_t i = 0; i < sample_size; ++i)
+	{
+		auto it = hash.find(targets[i % target_size]);
+		results[i % target_size] = it == hash.end() ? size : it->second;
+	}
+	chrono::high_resolution_clock::time_point end_time = chrono::high_resolution_clock::now();
+	double elapsed = chrono::duration<double, std::milli>{ end_time - start_time }.count();
+	return make_pair(move(results), elapsed);
+}
+
+template<class KeyTy>
+void run_benchmark_partial(const vector<size_t>& ref, double* accum, double* accum_sq, const vector<KeyTy>& keys, const vector<KeyTy>& targets, size_t sample_size)
+{
+}
+
+template<class KeyTy, class First, class... Rest>
+void run_benchmark_partial(const vector<size_t>& ref, double* accum, double* accum_sq, const vector<KeyTy>& keys, const vector<KeyTy>& targets, size_t sample_size)
+{
+	if (First{}.template is_valid<KeyTy>())
+	{
+		auto r = benchmark<KeyTy>(First{}, keys, targets, sample_size);
+		if (ref != r.first)
+		{
+			printf("    %s yields a wrong result!\n", First::_name.c_str());
+		}
+		*accum += r.second;
+		*accum_sq += r.second * r.second;
+	}
+	run_benchmark_partial<KeyTy, Rest...>(ref, accum + 1, accum_sq + 1, keys, targets, sample_size);
+}
+
+
+template<class KeyTy, class... Searchers>
+void run_benchmark_set(tuple<Searchers...>, size_t size, bool uniform, size_t sample_size, size_t repeat = 10, bool with_hash = true)
+{
+	vector<double> accum(sizeof ... (Searchers) + 2), accum_sq(sizeof ... (Searchers) + 2);
+	const auto keys = unique_rand_array<KeyTy>(size, uniform);
+	const auto targets = make_targets(keys);
+	for (size_t i = 0; i < repeat; ++i)
+	{
+		auto ref_result = benchmark<KeyTy>(ReferenceSearcher{}, keys, targets, sample_size);
+		accum[0] += ref_result.second;
 		accum_sq[0] += ref_result.second * ref_result.second;
-		auto ref_hash_result = benchmark_hash<KeyTy>(size, uniform, sample_size);
-		accum[1] += ref_hash_result.second;
-		accum_sq[1] += ref_hash_result.second * ref_hash_result.second;
-		run_benchmark_partial<KeyTy, Searchers...>(ref_result.first, accum.data() + 2, accum_sq.data() + 2, size, uniform, sample_size);
+		if (with_hash)
+		{
+			auto ref_hash_result = benchmark_hash<KeyTy>(keys, targets, sample_size);
+			accum[1] += ref_hash_result.second;
+			accum_sq[1] += ref_hash_result.second * ref_hash_result.second;
+		}
+		run_benchmark_partial<KeyTy, Searchers...>(ref_result.first, accum.data() + 2, accum_sq.data() + 2, keys, targets, sample_size);
 	}
 
 	static const char* names[] = {
@@ -562,6 +1417,418 @@ void run_benchmark_set(tuple<Searchers...>, size_t size, bool uniform, size_t sa
 	}
 }
 
+// rough peak memory of run_benchmark_set without the hash reference: the base keys,
+// the searched keys and values, the copies and index built by prepare() and a padded copy
+template<class KeyTy>
+size_t benchmark_bytes(size_t size)
+{
+	return size * (4 * sizeof(KeyTy) + 4 * sizeof(size_t));
+}
+
+// construction time of an n-ary layout from sorted keys, through nst_order and from the sorted order directly
+template<size_t n, class KeyTy>
+void run_build_benchmark_set(size_t size, size_t repeat = 10)
+{
+	auto sorted_keys = unique_rand_array<KeyTy>(size);
+	sort(sorted_keys.begin(), sorted_keys.end());
+
+	static const char* names[] = {
+		"nst_order + copy",
+		"build from sorted",
+		"in-place from sorted",
+	};
+	double accum[3] = { 0, }, accum_sq[3] = { 0, };
+	for (size_t i = 0; i < repeat; ++i)
+	{
+		page_vector<KeyTy> ref_keys;
+		for (size_t m = 0; m < 3; ++m)
+		{
+			page_vector<KeyTy> keys(sorted_keys.begin(), sorted_keys.end()), out_keys(m == 1 ? size : 0);
+			page_vector<size_t> values(size), out_values(m == 1 ? size : 0);
+			iota(values.begin(), values.end(), 0);
+
+			chrono::high_resolution_clock::time_point start_time = chrono::high_resolution_clock::now();
+			if (m == 0)
+			{
+				vector<size_t> idx = nst_order<n>(keys.data(), size);
+				vector<KeyTy> temp_keys{ keys.begin(), keys.end() };
+				vector<size_t> temp_values{ values.begin(), values.end() };
+				for (size_t j = 0; j < size; ++j)
+				{
+					keys[j] = temp_keys[idx[j]];
+					values[j] = temp_values[idx[j]];
+				}
+			}
+			else if (m == 1)
+			{
+				nst_build_sorted<n>(keys.data(), values.data(), size, out_keys.data(), out_values.data());
+				keys.swap(out_keys);
+			}
+			else
+			{
+				nst_permute_sorted<n>(keys.data(), values.data(), size);
+			}
+			chrono::high_resolution_clock::time_point end_time = chrono::high_resolution_clock::now();
+			double elapsed = chrono::duration<double, std::milli>{ end_time - start_time }.count();
+			accum[m] += elapsed;
+			accum_sq[m] += elapsed * elapsed;
+
+			if (m == 0) ref_keys.swap(keys);
+			else if (ref_keys != keys) printf("    %s yields a wrong result!\n", names[m]);
+		}
+	}
+
+	for (size_t m = 0; m < 3; ++m)
+	{
+		double mean = accum[m] / repeat;
+		double stdev = sqrt(max((accum_sq[m] / repeat) - mean * mean, 0.));
+		printf("  %-30s: %9.5g ms (%5.3g ms)\n", names[m], mean, stdev);
+	}
+}
+
+// build throughput of an n-ary layout from sorted keys against the number of threads
+template<size_t n, class KeyTy>
+void run_parallel_build_benchmark_set(size_t size, size_t repeat = 10)
+{
+	auto sorted_keys = unique_rand_array<KeyTy>(size);
+	sort(sorted_keys.begin(), sorted_keys.end());
+	page_vector<KeyTy> keys(sorted_keys.begin(), sorted_keys.end()), out_keys(size), ref_keys;
+	page_vector<size_t> values(size), out_values(size);
+	iota(values.begin(), values.end(), 0);
+
+	const size_t max_threads = default_threads();
+	for (size_t threads = 1; ; threads = min(threads * 2, max_threads))
+	{
+		double accum = 0, accum_sq = 0;
+		for (size_t i = 0; i < repeat; ++i)
+		{
+			chrono::high_resolution_clock::time_point start_time = chrono::high_resolution_clock::now();
+			nst_build_sorted_parallel<n>(keys.data(), values.data(), size, out_keys.data(), out_values.data(), threads);
+			chrono::high_resolution_clock::time_point end_time = chrono::high_resolution_clock::now();
+			double elapsed = chrono::duration<double, std::milli>{ end_time - start_time }.count();
+			accum += elapsed;
+			accum_sq += elapsed * elapsed;
+		}
+
+		if (threads == 1) ref_keys = out_keys;
+		else if (ref_keys != out_keys) printf("    %zd threads yield a wrong result!\n", threads);
+
+		double mean = accum / repeat;
+		double stdev = sqrt(max((accum_sq / repeat) - mean * mean, 0.));
+		printf("  %3zd thread%-21s: %9.5g ms (%5.3g ms), %7.4g Mkeys/s\n", threads, threads > 1 ? "s" : "", mean, stdev, size / mean / 1000);
+		if (threads == max_threads) break;
+	}
+}
+
+// rebuild of an n-ary layout with a sorted batch of size / 100 new keys and with a deletion set of size / 100 of its keys, from scratch and with the merge
+template<size_t n, class KeyTy>
+void run_merge_build_benchmark_set(size_t size, size_t repeat = 10)
+{
+	const size_t batch_size = size / 100;
+	auto all_keys = unique_rand_array<KeyTy>(size + batch_size);
+	vector<KeyTy> sorted_keys(all_keys.begin(), all_keys.begin() + size), batch_keys(all_keys.begin() + size, all_keys.end()), erase_keys;
+	sort(sorted_keys.begin(), sorted_keys.end());
+	sort(batch_keys.begin(), batch_keys.end());
+	for (size_t i = 0; i < size; i += 100) erase_keys.push_back(sorted_keys[i]);
+	vector<size_t> batch_values(batch_size);
+	iota(batch_values.begin(), batch_values.end(), size);
+
+	page_vector<KeyTy> keys(size);
+	page_vector<size_t> values(size);
+	{
+		vector<size_t> sorted_values(size);
+		iota(sorted_values.begin(), sorted_values.end(), 0);
+		nst_build_sorted<n>(sorted_keys.data(), sorted_values.data(), size, keys.data(), values.data());
+	}
+
+	static const char* names[] = {
+		"insert: concat + nst_arrange",
+		"insert: merge-rebuild",
+		"erase: filter + nst_arrange",
+		"erase: merge-rebuild",
+	};
+	double accum[4] = { 0, }, accum_sq[4] = { 0, };
+	for (size_t i = 0; i < repeat; ++i)
+	{
+		page_vector<KeyTy> ref_keys;
+		for (size_t m = 0; m < 4; ++m)
+		{
+			page_vector<KeyTy> out_keys(size + batch_size);
+			page_vector<size_t> out_values(size + batch_size);
+			size_t out_size = 0;
+
+			chrono::high_resolution_clock::time_point start_time = chrono::high_resolution_clock::now();
+			if (m == 0)
+			{
+				copy(keys.begin(), keys.end(), out_keys.begin());
+				copy(batch_keys.begin(), batch_keys.end(), out_keys.begin() + size);
+				copy(values.begin(), values.end(), out_values.begin());
+				copy(batch_values.begin(), batch_values.end(), out_values.begin() + size);
+				out_size = size + batch_size;
+				nst_arrange<n>(out_keys.data(), out_values.data(), out_size);
+			}
+			else if (m == 1)
+			{
+				out_size = nst_merge_build<n>(keys.data(), values.data(), size, batch_keys.data(), batch_values.data(), batch_size, out_keys.data(), out_values.data());
+			}
+			else if (m == 2)
+			{
+				for (size_t j = 0; j < size; ++j)
+				{
+					if (binary_search(erase_keys.begin(), erase_keys.end(), keys[j])) continue;
+					out_keys[out_size] = keys[j];
+					out_values[out_size++] = values[j];
+				}
+				nst_arrange<n>(out_keys.data(), out_values.data(), out_size);
+			}
+			else
+			{
+				out_size = nst_erase_build<n>(keys.data(), values.data(), size, erase_keys.data(), erase_keys.size(), out_keys.data(), out_values.data());
+			}
+			chrono::high_resolution_clock::time_point end_time = chrono::high_resolution_clock::now();
+			double elapsed = chrono::duration<double, std::milli>{ end_time - start_time }.count();
+			accum[m] += elapsed;
+			accum_sq[m] += elapsed * elapsed;
+
+			out_keys.resize(out_size);
+			if (m % 2 == 0) ref_keys.swap(out_keys);
+			else if (ref_keys != out_keys) printf("    %s yields a wrong result!\n", names[m]);
+		}
+	}
+
+	for (size_t m = 0; m < 4; ++m)
+	{
+		double mean = accum[m] / repeat;
+		double stdev = sqrt(max((accum_sq[m] / repeat) - mean * mean, 0.));
+		printf("  %-30s: %9.5g ms (%5.3g ms)\n", names[m], mean, stdev);
+	}
+}
+
+template<bound_kind kind>
+struct BoundQuery
+{
+	template<class Searcher, class KeyTy>
+	size_t operator()(Searcher& searcher, const KeyTy* keys, const size_t* values, size_t size, KeyTy target) const
+	{
+		size_t found;
+		return searcher.template bound<kind>(keys, values, size, target, found);
+	}
+};
+
+// sums the values of all keys in [target, target + span]
+template<class KeyTy>
+struct ScanQuery
+{
+	KeyTy span;
+
+	template<class Searcher>
+	size_t operator()(Searcher& searcher, const KeyTy* keys, const size_t* values, size_t size, KeyTy target) const
+	{
+		KeyTy hi = target > numeric_limits<KeyTy>::max() - span ? numeric_limits<KeyTy>::max() : (KeyTy)(target + span);
+		size_t sum = 0;
+		searcher.scan(keys, values, size, target, hi, [&](KeyTy, size_t v) { sum += v; });
+		return sum;
+	}
+};
+
+template<class KeyTy, class Searcher, class Query>
+pair<vector<size_t>, double> benchmark_query(Searcher&& searcher, const Query& query, const vector<KeyTy>& base_keys, const vector<KeyTy>& targets, size_t sample_size)
+{
+	const size_t size = base_keys.size();
+	const size_t target_size = targets.size();
+	page_vector<KeyTy> keys(base_keys.begin(), base_keys.end());
+	page_vector<size_t> values(size);
+	iota(values.begin(), values.end(), 0);
+
+	auto results = vector<size_t>(target_size, size);
+
+	searcher.prepare(keys.data(), values.data(), size);
+
+	chrono::high_resolution_clock::time_point start_time = chrono::high_resolution_clock::now();
+
+	for (size_t i = 0; i < sample_size; ++i)
+	{
+		results[i % target_size] = query(searcher, keys.data(), values.data(), size, targets[i % target_size]);
+	}
+
+	chrono::high_resolution_clock::time_point end_time = chrono::high_resolution_clock::now();
+	double elapsed = chrono::duration<double, std::milli>{ end_time - start_time }.count();
+	return make_pair(move(results), elapsed);
+}
+
+template<class KeyTy, class Query>
+void run_query_benchmark_partial(const vector<size_t>&, double*, double*, const Query&, const vector<KeyTy>&, const vector<KeyTy>&, size_t)
+{
+}
+
+template<class KeyTy, class Query, class First, class... Rest>
+void run_query_benchmark_partial(const vector<size_t>& ref, double* accum, double* accum_sq, const Query& query, const vector<KeyTy>& keys, const vector<KeyTy>& targets, size_t sample_size)
+{
+	if (First{}.template is_valid<KeyTy>())
+	{
+		auto r = benchmark_query<KeyTy>(First{}, query, keys, targets, sample_size);
+		if (ref != r.first)
+		{
+			printf("    %s yields a wrong result!\n", First::_name.c_str());
+		}
+		*accum += r.second;
+		*accum_sq += r.second * r.second;
+	}
+	run_query_benchmark_partial<KeyTy, Query, Rest...>(ref, accum + 1, accum_sq + 1, query, keys, targets, sample_size);
+}
+
+// times query(searcher, ...) for every searcher, the results are checked against ReferenceSearcher
+template<class KeyTy, class Query, class... Searchers>
+void run_query_benchmark_set(tuple<Searchers...>, const Query& query, const vector<KeyTy>& keys, size_t sample_size, size_t repeat = 10)
+{
+	vector<double> accum(sizeof ... (Searchers) + 1), accum_sq(sizeof ... (Searchers) + 1);
+	const auto targets = make_targets(keys);
+	for (size_t i = 0; i < repeat; ++i)
+	{
+		auto ref_result = benchmark_query<KeyTy>(ReferenceSearcher{}, query, keys, targets, sample_size);
+		accum[0] += ref_result.second;
+		accum_sq[0] += ref_result.second * ref_result.second;
+		run_query_benchmark_partial<KeyTy, Query, Searchers...>(ref_result.first, accum.data() + 1, accum_sq.data() + 1, query, keys, targets, sample_size);
+	}
+
+	static const char* names[] = {
+		ReferenceSearcher::_name.c_str(),
+		(Searchers::_name.c_str())...,
+	};
+
+	for (size_t i = 0; i < accum.size(); ++i)
+	{
+		if (accum[i] == 0) continue;
+		double mean = accum[i] / repeat;
+		double stdev = sqrt(max((accum_sq[i] / repeat) - mean * mean, 0.));
+		printf("  %-30s: %9.5g ms (%5.3g ms)\n", names[i], mean, stdev);
+	}
+}
+
+template<class Searcher, class KeyTy, class = void>
+struct has_thread_view : false_type {};
+
+template<class Searcher, class KeyTy>
+struct has_thread_view<Searcher, KeyTy, decltype(declval<Searcher&>().template thread_view<KeyTy, size_t>(), void())> : true_type {};
+
+// searchers whose search() keeps per-reader state give every thread a view of its own, the others are shared as they are
+template<class KeyTy, class Searcher>
+Searcher& thread_searcher(Searcher& searcher, false_type)
+{
+	return searcher;
+}
+
+template<class KeyTy, class Searcher>
+auto thread_searcher(Searcher& searcher, true_type)
+{
+	return searcher.template thread_view<KeyTy, size_t>();
+}
+
+// written by one thread only, padded so that the results of neighbouring threads do not share a cache line
+struct alignas(64) thread_result
+{
+	vector<size_t> results;
+	double elapsed = 0;
+};
+
+// sample_size lookups on each of threads threads, thread t pinned to cpus[t] and searching targets[t], returns the wall time from the common start to the last finish
+template<class KeyTy, class Searcher>
+double run_threads(Searcher& searcher, const page_vector<KeyTy>& keys, const page_vector<size_t>& values, const vector<vector<KeyTy>>& targets, const vector<size_t>& cpus, size_t threads, size_t sample_size, vector<thread_result>& out)
+{
+	out.assign(threads, thread_result{});
+	atomic<size_t> ready{ 0 };
+	atomic<bool> go{ false };
+	vector<thread> workers;
+	for (size_t t = 0; t < threads; ++t)
+	{
+		workers.emplace_back([&, t]()
+		{
+			pin_current_thread(cpus[t]);
+			auto&& local = thread_searcher<KeyTy>(searcher, has_thread_view<Searcher, KeyTy>{});
+			vector<size_t> results(targets[t].size(), keys.size());
+			ready.fetch_add(1, memory_order_release);
+			while (!go.load(memory_order_acquire)) this_thread::yield();
+
+			chrono::high_resolution_clock::time_point start_time = chrono::high_resolution_clock::now();
+			search_loop(local, keys, values, targets[t], results, sample_size, has_search_batch<typename decay<decltype(local)>::type, KeyTy>{});
+			chrono::high_resolution_clock::time_point end_time = chrono::high_resolution_clock::now();
+			out[t].elapsed = chrono::duration<double, std::milli>{ end_time - start_time }.count();
+			out[t].results = move(results);
+		});
+	}
+
+	while (ready.load(memory_order_acquire) < threads) this_thread::yield();
+	chrono::high_resolution_clock::time_point start_time = chrono::high_resolution_clock::now();
+	go.store(true, memory_order_release);
+	for (auto& w : workers) w.join();
+	chrono::high_resolution_clock::time_point end_time = chrono::high_resolution_clock::now();
+	return chrono::duration<double, std::milli>{ end_time - start_time }.count();
+}
+
+template<class KeyTy>
+void run_throughput_partial(const vector<KeyTy>&, const vector<vector<KeyTy>>&, const vector<vector<size_t>>&, const vector<size_t>&, const vector<size_t>&, size_t)
+{
+}
+
+template<class KeyTy, class First, class... Rest>
+void run_throughput_partial(const vector<KeyTy>& keys, const vector<vector<KeyTy>>& targets, const vector<vector<size_t>>& refs, const vector<size_t>& cpus, const vector<size_t>& thread_counts, size_t sample_size)
+{
+	if (First{}.template is_valid<KeyTy>())
+	{
+		const size_t size = keys.size();
+		page_vector<KeyTy> prepared_keys(keys.begin(), keys.end());
+		page_vector<size_t> values(size);
+		iota(values.begin(), values.end(), 0);
+		First searcher{};
+		searcher.prepare(prepared_keys.data(), values.data(), size);
+
+		printf("  %-30s:", First::_name.c_str());
+		bool wrong = false;
+		double single = 0;
+		for (size_t threads : thread_counts)
+		{
+			vector<thread_result> out;
+			const double elapsed = run_threads<KeyTy>(searcher, prepared_keys, values, targets, cpus, threads, sample_size, out);
+			for (size_t t = 0; t < threads; ++t) wrong |= out[t].results != refs[t];
+			const double mlookups = threads * sample_size / elapsed / 1000;
+			if (threads == 1) single = mlookups;
+			printf(" %7.4g (%3.0f%%)", mlookups, 100 * mlookups / (threads * single));
+		}
+		printf("\n");
+		if (wrong) printf("    %s yields a wrong result!\n", First::_name.c_str());
+	}
+	run_throughput_partial<KeyTy, Rest...>(keys, targets, refs, cpus, thread_counts, sample_size);
+}
+
+/*
+ * Aggregate Mlookups/s of every searcher on 1, 2, 4, ... threads that share
+ * one prepared array, and in brackets the scaling efficiency against the
+ * single thread. Every thread runs sample_size lookups over a target stream
+ * of its own and is pinned to the next CPU of the placement.
+ */
+template<class KeyTy, class... Searchers>
+void run_throughput_benchmark_set(tuple<Searchers...>, size_t size, thread_placement placement, size_t sample_size)
+{
+	const auto cpus = placement_order(available_cpus(), placement);
+	vector<size_t> thread_counts;
+	for (size_t threads = 1; threads < cpus.size(); threads *= 2) thread_counts.push_back(threads);
+	thread_counts.push_back(cpus.size());
+
+	const auto keys = unique_rand_array<KeyTy>(size, true);
+	vector<vector<KeyTy>> targets;
+	vector<vector<size_t>> refs;
+	for (size_t t = 0; t < cpus.size(); ++t)
+	{
+		targets.push_back(make_targets(keys, 0.5, 777 + t));
+		refs.push_back(benchmark<KeyTy>(ReferenceSearcher{}, keys, targets[t], targets[t].size()).first);
+	}
+
+	printf("  %-30s:", "threads (CPUs)");
+	for (size_t threads : thread_counts) printf(" %7zd %6s", threads, "");
+	printf("\n");
+	run_throughput_partial<KeyTy, Searchers...>(keys, targets, refs, cpus, thread_counts, sample_size);
+}
+
 int main(int argc, char** argv)
 {
 	const size_t sample_size = 1000 * 1000;
@@ -584,29 +1851,169 @@ int main(int argc, char** argv)
 		SSE2NSTSearcher2<5>,
 		SSE2NSTSearcher2<9>,
 		SSE2NSTSearcher2<17>,
+		SSE2NSTPaddedSearcher<9>,
+		SSE2NSTPaddedSearcher<17>,
+		SSE2NSTPaddedSearcher<17, value_layout::prefetched>,
+		SSE2NSTPaddedSearcher<17, value_layout::colocated>,
+		SSE2FASTSearcher<9>,
+		SSE2FASTSearcher<17>,
 #endif
 #ifdef __AVX2__
 		AVX2BBSearcher,
 		AVX2BBPrefetchSearcher,
+		AVX2NSTSearcher<5>,
 		AVX2NSTSearcher<9>,
 		AVX2NSTSearcher<17>,
+		AVX2NSTSearcher2<5>,
 		AVX2NSTSearcher2<9>,
 		AVX2NSTSearcher2<17>,
+		AVX2NSTPaddedSearcher<9>,
+		AVX2NSTPaddedSearcher<17>,
+		AVX2NSTPaddedSearcher<17, value_layout::prefetched>,
+		AVX2NSTPaddedSearcher<17, value_layout::colocated>,
+		AVX2FASTSearcher<17>,
+		AVX2FORSearcher,
+		AVX2TruncatedSearcher<int8_t>,
+		AVX2TruncatedSearcher<int16_t>,
+		AVX2LearnedSearcher,
+		AVX2RadixSearcher,
+		AVX2SIPSearcher,
+		AVX2TIPSearcher,
+		AVX2BBBatchSearcher,
+		AVX2NSTBatchSearcher<5>,
+#endif
+#if defined(__cpp_impl_coroutine)
+		CoroBBSearcher<8>,
+		CoroBSTSearcher<8>,
+#ifdef __AVX2__
+		CoroAVX2NSTSearcher<17, 8>,
+#endif
 #endif
 #if defined(__ARM_NEON__) || defined(__ARM_NEON)
 		NeonSTSearcher,
 		NeonST2Searcher,
 #endif
 		BSTSearcher,
+		EytzingerSearcher,
 		NSTSearcher<3>,
 		NSTSearcher<5>,
 		NSTSearcher<9>,
 		NSTSearcher<17>,
 		MixedNSTSearcher<5>,
 		MixedNSTSearcher<9>,
-		MixedNSTSearcher<17>
+		MixedNSTSearcher<17>,
+		GroupBBSearcher<8>,
+		GroupBBSearcher<16>,
+		AMACBSTSearcher<16>,
+		AMACNSTSearcher<5, 8>,
+		AMACNSTSearcher<9, 8>,
+		DispatchBBSearcher,
+		DispatchNSTSearcher<9>,
+		DispatchNSTSearcher<17>,
+		DispatchNSTSearcher2<17>,
+		LearnedSearcher,
+		RadixSearcher,
+		SIPSearcher,
+		TIPSearcher,
+		FORSearcher,
+		TruncatedSearcher<int8_t>,
+		TruncatedSearcher<int16_t>,
+		BufferedNSTSearcher<17>,
+		SnapshotNSTSearcher<17>
+	>;
+
+
+	using BoundSearchers = tuple<
+#if defined(__SSE2__) || defined(__AVX2__)
+		SSE2NSTSearcher<9>,
+		SSE2NSTSearcher<17>,
+#endif
+#ifdef __AVX2__
+		AVX2NSTSearcher<9>,
+		AVX2NSTSearcher<17>,
+#endif
+		BSTSearcher,
+		EytzingerSearcher,
+		NSTSearcher<9>,
+		NSTSearcher<17>,
+		DispatchNSTSearcher<17>
+	>;
+
+	using ScanSearchers = tuple<
+		BSTSearcher,
+		NSTSearcher<9>,
+		NSTSearcher<17>
+	>;
+
+	using LargeSearchers = tuple<
+#if defined(__SSE2__) || defined(__AVX2__)
+		SSE2NSTPaddedSearcher<17>,
+		SSE2NSTPaddedSearcher<17, value_layout::colocated>,
+		SSE2FASTSearcher<17>,
+#endif
+#ifdef __AVX2__
+		AVX2NSTSearcher<17>,
+		AVX2NSTSearcher2<17>,
+		AVX2NSTPaddedSearcher<17>,
+		AVX2NSTPaddedSearcher<17, value_layout::prefetched>,
+		AVX2NSTPaddedSearcher<17, value_layout::colocated>,
+		AVX2FASTSearcher<17>,
+		AVX2FORSearcher,
+		AVX2TruncatedSearcher<int8_t>,
+		AVX2TruncatedSearcher<int16_t>,
+		AVX2LearnedSearcher,
+		AVX2RadixSearcher,
+		AVX2SIPSearcher,
+		AVX2TIPSearcher,
+#endif
+		BSTSearcher,
+		EytzingerSearcher,
+		LearnedSearcher,
+		RadixSearcher,
+		SIPSearcher,
+		TIPSearcher,
+		NSTSearcher<17>,
+		DispatchNSTSearcher<17>,
+		BufferedNSTSearcher<17>,
+		SnapshotNSTSearcher<17>
 	>;
 
+	printf("Runtime dispatch: %s kernels\n", simd_level_name(runtime_simd_level()));
+
+	vector<page_kind> page_kinds;
+	printf("Pages:");
+	for (page_kind kind : { page_kind::small, page_kind::transparent_huge, page_kind::huge_2m, page_kind::huge_1g })
+	{
+		const bool available = page_kind_available(kind);
+		if (available) page_kinds.emplace_back(kind);
+		printf(" %s (%s)", page_kind_name(kind), available ? "yes" : "no");
+	}
+	printf("\n\n");
+
+	// "bench.out <repeat> throughput" runs only the multi-threaded throughput mode
+	if (argc > 2 && strcmp(argv[2], "throughput") == 0)
+	{
+		const auto cpus = available_cpus();
+		printf("CPUs: %zd logical on %zd cores\n\n", cpus.size(), physical_cores(cpus));
+		for (thread_placement placement : { thread_placement::distinct_cores, thread_placement::smt_siblings })
+		{
+			if (placement == thread_placement::smt_siblings && physical_cores(cpus) == cpus.size()) continue;
+			for (size_t size : { 1000000, 10000000 })
+			{
+				const size_t needed = benchmark_bytes<int32_t>(size), available = available_memory();
+				if (available && needed > available / 10 * 9)
+				{
+					printf("======== int32_t throughput, size=%zd: skipped, needs about %zd MiB of %zd MiB available ========\n\n\n", size, needed >> 20, available >> 20);
+					continue;
+				}
+				printf("======== int32_t throughput, size=%zd, placement=%s, Mlookups/s (efficiency) ========\n", size, thread_placement_name(placement));
+				run_throughput_benchmark_set<int32_t>(Searchers{}, size, placement, sample_size);
+				printf("\n\n");
+			}
+		}
+		return 0;
+	}
+
 	for (bool uniform : {true, false})
 	{
 		for (size_t size : { 25, 50, 100, 200, 400, 800, 1600, 3200, 6400, 12800 })
@@ -622,6 +2029,111 @@ int main(int argc, char** argv)
 			run_benchmark_set<int32_t>(Searchers{}, size, uniform, sample_size, repeat);
 			printf("\n\n");
 		}
+
+		for (size_t size : { 25, 50, 100, 200, 400, 800, 1600, 3200, 6400, 12800 })
+		{
+			printf("======== uint32_t, size=%zd, uniform_dist=%s ========\n", size, uniform ? "true" : "false");
+			run_benchmark_set<uint32_t>(Searchers{}, size, uniform, sample_size, repeat);
+			printf("\n\n");
+		}
+
+		for (size_t size : { 25, 50, 100, 200, 400, 800, 1600, 3200, 6400, 12800 })
+		{
+			printf("======== float, size=%zd, uniform_dist=%s ========\n", size, uniform ? "true" : "false");
+			run_benchmark_set<float>(Searchers{}, size, uniform, sample_size, repeat);
+			printf("\n\n");
+		}
+
+		// 2 and 8 keys span most of the 64-bit range with the non-uniform distribution
+		for (size_t size : { 2, 8, 25, 50, 100, 200, 400, 800, 1600, 3200, 6400, 12800, 100000, 1000000, 10000000 })
+		{
+			const size_t needed = benchmark_bytes<int64_t>(size), available = available_memory();
+			if (available && needed > available / 10 * 9)
+			{
+				printf("======== int64_t, size=%zd: skipped, needs about %zd MiB of %zd MiB available ========\n\n\n", size, needed >> 20, available >> 20);
+				continue;
+			}
+			printf("======== int64_t, size=%zd, uniform_dist=%s ========\n", size, uniform ? "true" : "false");
+			run_benchmark_set<int64_t>(Searchers{}, size, uniform, sample_size, repeat);
+			printf("\n\n");
+		}
+
+		for (size_t size : { 100, 1600, 12800, 100000, 1000000 })
+		{
+			const auto keys = unique_rand_array<int32_t>(size, uniform);
+			printf("======== int32_t lower_bound, size=%zd, uniform_dist=%s ========\n", size, uniform ? "true" : "false");
+			run_query_benchmark_set(BoundSearchers{}, BoundQuery<bound_kind::lower>{}, keys, sample_size, repeat);
+			printf("\n\n");
+			printf("======== int32_t predecessor, size=%zd, uniform_dist=%s ========\n", size, uniform ? "true" : "false");
+			run_query_benchmark_set(BoundSearchers{}, BoundQuery<bound_kind::predecessor>{}, keys, sample_size, repeat);
+			printf("\n\n");
+			// about 16 keys per range
+			const auto span = (int32_t)min((int64_t)numeric_limits<int32_t>::max(), (((int64_t)1 << 32) / (int64_t)size) * 16);
+			printf("======== int32_t scan, size=%zd, uniform_dist=%s ========\n", size, uniform ? "true" : "false");
+			run_query_benchmark_set(ScanSearchers{}, ScanQuery<int32_t>{ span }, keys, sample_size / 16, repeat);
+			printf("\n\n");
+		}
+	}
+
+#if defined(__cpp_impl_coroutine)
+	// the coroutine searchers are meant to run without allocating
+	if (coro_frame_pool::local().heap_frames()) printf("    %zd coroutine frames fell back to the heap!\n\n\n", coro_frame_pool::local().heap_frames());
+#endif
+
+	for (size_t size : { 100000, 1000000, 10000000 })
+	{
+		printf("======== int32_t build, 2-ary, size=%zd ========\n", size);
+		run_build_benchmark_set<2, int32_t>(size, repeat);
+		printf("\n\n");
+		printf("======== int32_t build, 17-ary, size=%zd ========\n", size);
+		run_build_benchmark_set<17, int32_t>(size, repeat);
+		printf("\n\n");
+	}
+
+	for (size_t size : { 10000000, 100000000 })
+	{
+		const size_t needed = benchmark_bytes<int32_t>(size), available = available_memory();
+		if (available && needed > available / 10 * 9)
+		{
+			printf("======== int32_t parallel build, size=%zd: skipped, needs about %zd MiB of %zd MiB available ========\n\n\n", size, needed >> 20, available >> 20);
+			continue;
+		}
+		printf("======== int32_t parallel build, 17-ary, size=%zd ========\n", size);
+		run_parallel_build_benchmark_set<17, int32_t>(size, repeat);
+		printf("\n\n");
+	}
+
+	for (size_t size : { 1000000, 10000000, 100000000 })
+	{
+		const size_t needed = benchmark_bytes<int32_t>(size), available = available_memory();
+		if (available && needed > available / 10 * 9)
+		{
+			printf("======== int32_t merge-rebuild, size=%zd: skipped, needs about %zd MiB of %zd MiB available ========\n\n\n", size, needed >> 20, available >> 20);
+			continue;
+		}
+		printf("======== int32_t merge-rebuild, 17-ary, size=%zd ========\n", size);
+		run_merge_build_benchmark_set<17, int32_t>(size, repeat);
+		printf("\n\n");
+	}
+
+	// the TLB-bound regime, every size once per page kind
+	for (size_t size : { 100000, 1000000, 10000000, 100000000, 1000000000 })
+	{
+		const size_t needed = benchmark_bytes<int32_t>(size), available = available_memory();
+		if (available && needed > available / 10 * 9)
+		{
+			printf("======== int32_t, size=%zd: skipped, needs about %zd MiB of %zd MiB available ========\n\n\n", size, needed >> 20, available >> 20);
+			continue;
+		}
+
+		for (page_kind kind : page_kinds)
+		{
+			default_page_kind() = kind;
+			printf("======== int32_t, size=%zd, uniform_dist=true, pages=%s ========\n", size, page_kind_name(kind));
+			run_benchmark_set<int32_t>(LargeSearchers{}, size, true, sample_size, repeat, false);
+			printf("\n\n");
+		}
+		default_page_kind() = page_kind::small;
 	}
 	return 0;
 }
@@ -0,0 +1,198 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+
+#include "bst.hpp"
+#include "page_alloc.hpp"
+#include "parallel.hpp"
+
+/*
+ * Construction of the nst_order / bst_order layouts from keys that are
+ * already sorted. The layout is a search tree, so its in-order walk visits
+ * the sorted keys one after another: nst_build_sorted writes them in a
+ * single recursive pass, O(n) with no index array and no sort.
+ * nst_permute_sorted does the same in place by following the cycles of the
+ * permutation, with nst_rank telling which sorted key goes to a position
+ * and one bit per key marking the positions that are done. It costs
+ * O(n log n) rank computations and random accesses, several times slower
+ * than the copy, but needs only size / 8 bytes of extra memory.
+ */
+
+// writes the subtree of the node starting at i, taking keys and values in order
+template<size_t n, class KeyTy, class ValueTy>
+void nst_fill(const KeyTy*& keys, const ValueTy*& values, size_t size, size_t i, KeyTy* out_keys, ValueTy* out_values)
+{
+	const size_t ke = std::min(n - 1, size - i);
+	for (size_t k = 0; k <= ke; ++k)
+	{
+		const size_t c = i * n + (n - 1) * (k + 1);
+		if (c < size) nst_fill<n>(keys, values, size, c, out_keys, out_values);
+		if (k < ke)
+		{
+			out_keys[i + k] = *keys++;
+			out_values[i + k] = *values++;
+		}
+	}
+}
+
+// keys must be sorted, out_keys / out_values must not overlap them
+template<size_t n, class KeyTy, class ValueTy>
+void nst_build_sorted(const KeyTy* keys, const ValueTy* values, size_t size, KeyTy* out_keys, ValueTy* out_values)
+{
+	if (size) nst_fill<n>(keys, values, size, 0, out_keys, out_values);
+}
+
+// number of keys in the subtree of node number m
+template<size_t n>
+size_t nst_subtree_size(size_t m, size_t size)
+{
+	const size_t nodes = (size + n - 2) / (n - 1);
+	size_t count = 0;
+	for (size_t first = m, last = m; first < nodes; first = first * n + 1, last = last * n + n)
+	{
+		count += std::min(size, (last + 1) * (n - 1)) - first * (n - 1);
+	}
+	return count;
+}
+
+// fills the nodes less than depth levels below node i, and collects the subtrees at that depth with the offset of their first sorted key
+template<size_t n, class KeyTy, class ValueTy>
+void nst_fill_top(const KeyTy* keys, const ValueTy* values, size_t size, size_t i, size_t depth, size_t& offset, KeyTy* out_keys, ValueTy* out_values, std::vector<std::pair<size_t, size_t>>& subtrees)
+{
+	if (depth == 0)
+	{
+		subtrees.emplace_back(i, offset);
+		offset += nst_subtree_size<n>(i / (n - 1), size);
+		return;
+	}
+
+	const size_t ke = std::min(n - 1, size - i);
+	for (size_t k = 0; k <= ke; ++k)
+	{
+		const size_t c = i * n + (n - 1) * (k + 1);
+		if (c < size) nst_fill_top<n>(keys, values, size, c, depth - 1, offset, out_keys, out_values, subtrees);
+		if (k < ke)
+		{
+			out_keys[i + k] = keys[offset];
+			out_values[i + k] = values[offset];
+			++offset;
+		}
+	}
+}
+
+/*
+ * The subtree of a node holds a contiguous range of the sorted keys and, on
+ * every level, a contiguous range of positions. The top levels are filled
+ * first, which gives the range of each subtree below them, and then the
+ * subtrees are filled in parallel without any synchronization.
+ * Splitting at the depth with 8 subtrees per thread keeps the threads
+ * busy when the subtrees on the partial last level are smaller.
+ */
+template<size_t n, class KeyTy, class ValueTy>
+void nst_build_sorted_parallel(const KeyTy* keys, const ValueTy* values, size_t size, KeyTy* out_keys, ValueTy* out_values, size_t num_threads = default_threads())
+{
+	static constexpr size_t min_subtree = 1 << 16;
+
+	size_t depth = 0;
+	for (size_t subtrees = 1; subtrees < num_threads * 8 && size / (subtrees * n) >= min_subtree; subtrees *= n) ++depth;
+	if (depth == 0) return nst_build_sorted<n>(keys, values, size, out_keys, out_values);
+
+	std::vector<std::pair<size_t, size_t>> subtrees;
+	size_t offset = 0;
+	nst_fill_top<n>(keys, values, size, 0, depth, offset, out_keys, out_values, subtrees);
+
+	parallel_tasks(subtrees.size(), num_threads, [&](size_t t)
+	{
+		const KeyTy* k = keys + subtrees[t].second;
+		const ValueTy* v = values + subtrees[t].second;
+		nst_fill<n>(k, v, size, subtrees[t].first, out_keys, out_values);
+	});
+}
+
+template<class KeyTy, class ValueTy>
+void bst_build_sorted_parallel(const KeyTy* keys, const ValueTy* values, size_t size, KeyTy* out_keys, ValueTy* out_values, size_t num_threads = default_threads())
+{
+	nst_build_sorted_parallel<2>(keys, values, size, out_keys, out_values, num_threads);
+}
+
+template<class KeyTy, class ValueTy>
+void bst_build_sorted(const KeyTy* keys, const ValueTy* values, size_t size, KeyTy* out_keys, ValueTy* out_values)
+{
+	nst_build_sorted<2>(keys, values, size, out_keys, out_values);
+}
+
+// keys must be sorted
+template<size_t n, class KeyTy, class ValueTy>
+void nst_permute_sorted(KeyTy* keys, ValueTy* values, size_t size)
+{
+	page_vector<uint64_t> done((size + 63) / 64);
+	for (size_t s = 0; s < size; ++s)
+	{
+		if (done[s / 64] & ((uint64_t)1 << (s % 64))) continue;
+
+		// position p receives the key of sorted index nst_rank(p), which is still unmoved
+		const KeyTy first_key = keys[s];
+		const ValueTy first_value = values[s];
+		size_t p = s;
+		while (true)
+		{
+			done[p / 64] |= (uint64_t)1 << (p % 64);
+			const size_t q = nst_rank<n>(p, size);
+			if (q == s) break;
+			keys[p] = keys[q];
+			values[p] = values[q];
+			p = q;
+		}
+		keys[p] = first_key;
+		values[p] = first_value;
+	}
+}
+
+template<class KeyTy, class ValueTy>
+void bst_permute_sorted(KeyTy* keys, ValueTy* values, size_t size)
+{
+	nst_permute_sorted<2>(keys, values, size);
+}
+
+/*
+ * Permutes keys and values into the nst_order layout: sorts the pairs in
+ * place (radix sort for integer keys), copies the sorted order and builds
+ * the layout from the copy in O(n) on num_threads threads. The sort
+ * scratch is freed before the copy is made, so the peak is one extra copy
+ * of the pairs.
+ */
+template<size_t n, class KeyTy, class ValueTy>
+void nst_arrange(KeyTy* keys, ValueTy* values, size_t size, size_t num_threads = default_threads())
+{
+	sort_pairs(keys, values, size);
+	page_vector<KeyTy> sorted_keys{ keys, keys + size };
+	page_vector<ValueTy> sorted_values{ values, values + size };
+	nst_build_sorted_parallel<n>(sorted_keys.data(), sorted_values.data(), size, keys, values, num_threads);
+}
+
+template<class KeyTy, class ValueTy>
+void bst_arrange(KeyTy* keys, ValueTy* values, size_t size, size_t num_threads = default_threads())
+{
+	nst_arrange<2>(keys, values, size, num_threads);
+}
+
+/*
+ * nst_arrange for callers that cannot afford the copy: permutes the sorted
+ * order in place with nst_permute_sorted, so the only memory beyond
+ * size / 8 bytes is the sort scratch, which sorted input does not need.
+ * Several times slower than nst_arrange.
+ */
+template<size_t n, class KeyTy, class ValueTy>
+void nst_arrange_in_place(KeyTy* keys, ValueTy* values, size_t size)
+{
+	sort_pairs(keys, values, size);
+	nst_permute_sorted<n>(keys, values, size);
+}
+
+template<class KeyTy, class ValueTy>
+void bst_arrange_in_place(KeyTy* keys, ValueTy* values, size_t size)
+{
+	nst_arrange_in_place<2>(keys, values, size);
+}
@@ -0,0 +1,194 @@
+#pragma once
+
+#include <iterator>
+
+#include "balanced_binary.hpp"
+#include "bst.hpp"
+
+/*
+ * In-order traversal of the nst_order / bst_order layouts.
+ * The key at position p belongs to the node starting at i = p - p % (n - 1),
+ * whose node number m = i / (n - 1) has its children at m * n + 1 ... m * n + n
+ * and its parent at (m - 1) / n. Only the last node of a layout can be partial,
+ * and it is always a leaf. Stepping to the next or previous key walks at most
+ * one root-to-leaf path, which is O(1) amortised over a scan.
+ * Positions past the last key (and before the first one) are represented by size.
+ */
+
+// position of the smallest key in the subtree of the node starting at i
+template<size_t n>
+size_t nst_leftmost(size_t i, size_t size)
+{
+	for (size_t c = i * n + (n - 1); c < size; c = c * n + (n - 1)) i = c;
+	return i;
+}
+
+// position of the largest key in the subtree of the node starting at i
+template<size_t n>
+size_t nst_rightmost(size_t i, size_t size)
+{
+	while (true)
+	{
+		size_t ke = std::min(n - 1, size - i);
+		size_t c = i * n + (n - 1) * (ke + 1);
+		if (c >= size) return i + ke - 1;
+		i = c;
+	}
+}
+
+template<size_t n>
+size_t nst_first(size_t size)
+{
+	return size ? nst_leftmost<n>(0, size) : size;
+}
+
+template<size_t n>
+size_t nst_last(size_t size)
+{
+	return size ? nst_rightmost<n>(0, size) : size;
+}
+
+template<size_t n>
+size_t nst_next(size_t p, size_t size)
+{
+	if (p >= size) return nst_first<n>(size);
+
+	size_t i = p - p % (n - 1), k = p - i;
+	size_t c = i * n + (n - 1) * (k + 2);
+	if (c < size) return nst_leftmost<n>(c, size);
+	if (k + 1 < std::min(n - 1, size - i)) return p + 1;
+
+	// climb while the node is the last child of its parent
+	for (size_t m = i / (n - 1); m > 0; m = (m - 1) / n)
+	{
+		size_t parent = (m - 1) / n, ck = (m - 1) % n;
+		if (ck < n - 1) return parent * (n - 1) + ck;
+	}
+	return size;
+}
+
+template<size_t n>
+size_t nst_prev(size_t p, size_t size)
+{
+	if (p >= size) return nst_last<n>(size);
+
+	size_t i = p - p % (n - 1), k = p - i;
+	size_t c = i * n + (n - 1) * (k + 1);
+	if (c < size) return nst_rightmost<n>(c, size);
+	if (k > 0) return p - 1;
+
+	// climb while the node is the first child of its parent
+	for (size_t m = i / (n - 1); m > 0; m = (m - 1) / n)
+	{
+		size_t parent = (m - 1) / n, ck = (m - 1) % n;
+		if (ck > 0) return parent * (n - 1) + ck - 1;
+	}
+	return size;
+}
+
+// bidirectional iterator over the keys of a layout in sorted order, value() gives the value of the current key
+template<size_t n, class KeyTy, class ValueTy>
+class nst_iterator
+{
+public:
+	using iterator_category = std::bidirectional_iterator_tag;
+	using value_type = KeyTy;
+	using difference_type = std::ptrdiff_t;
+	using pointer = const KeyTy*;
+	using reference = const KeyTy&;
+
+	nst_iterator(const KeyTy* _keys, const ValueTy* _values, size_t _size, size_t _pos)
+		: keys{ _keys }, values{ _values }, size{ _size }, pos{ _pos }
+	{
+	}
+
+	reference operator*() const { return keys[pos]; }
+	pointer operator->() const { return &keys[pos]; }
+
+	const KeyTy& key() const { return keys[pos]; }
+	const ValueTy& value() const { return values[pos]; }
+
+	// position in the layout, size at the end
+	size_t position() const { return pos; }
+
+	// index of the current key in sorted order
+	size_t rank() const { return nst_rank<n>(pos, size); }
+
+	nst_iterator& operator++()
+	{
+		pos = nst_next<n>(pos, size);
+		return *this;
+	}
+
+	nst_iterator operator++(int)
+	{
+		nst_iterator ret = *this;
+		++*this;
+		return ret;
+	}
+
+	nst_iterator& operator--()
+	{
+		pos = nst_prev<n>(pos, size);
+		return *this;
+	}
+
+	nst_iterator operator--(int)
+	{
+		nst_iterator ret = *this;
+		--*this;
+		return ret;
+	}
+
+	bool operator==(const nst_iterator& o) const { return pos == o.pos; }
+	bool operator!=(const nst_iterator& o) const { return pos != o.pos; }
+
+private:
+	const KeyTy* keys;
+	const ValueTy* values;
+	size_t size, pos;
+};
+
+template<size_t n, class KeyTy, class ValueTy>
+nst_iterator<n, KeyTy, ValueTy> nst_begin(const KeyTy* keys, const ValueTy* values, size_t size)
+{
+	return { keys, values, size, nst_first<n>(size) };
+}
+
+template<size_t n, class KeyTy, class ValueTy>
+nst_iterator<n, KeyTy, ValueTy> nst_end(const KeyTy* keys, const ValueTy* values, size_t size)
+{
+	return { keys, values, size, size };
+}
+
+// iterator at the first key >= target
+template<size_t n, class KeyTy, class ValueTy>
+nst_iterator<n, KeyTy, ValueTy> nst_seek(const KeyTy* keys, const ValueTy* values, size_t size, KeyTy target)
+{
+	return { keys, values, size, nst_lower_bound<n>(keys, size, target) };
+}
+
+/*
+ * Calls callback(key, value) for every key in [lo, hi] in ascending order
+ * and returns the number of keys visited. Consecutive leaves of the layout
+ * are adjacent in memory, so the leaves ahead of the scan are prefetched.
+ */
+template<size_t n, class KeyTy, class ValueTy, class Callback>
+size_t nst_scan(const KeyTy* keys, const ValueTy* values, size_t size, KeyTy lo, KeyTy hi, Callback&& callback)
+{
+	static constexpr size_t key_distance = 512 / sizeof(KeyTy);
+	static constexpr size_t value_distance = 512 / sizeof(ValueTy);
+
+	size_t count = 0;
+	for (size_t p = nst_lower_bound<n>(keys, size, lo); p < size && !(hi < keys[p]); p = nst_next<n>(p, size))
+	{
+		if (p % (n - 1) == 0)
+		{
+			if (p + key_distance < size) prefetch(&keys[p + key_distance]);
+			if (p + value_distance < size) prefetch(&values[p + value_distance]);
+		}
+		callback(keys[p], values[p]);
+		++count;
+	}
+	return count;
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstdint>
+#include <algorithm>
+
+#include "bst.hpp"
+#include "nst_iterator.hpp"
+
+/*
+ * Rebuild of an nst_order layout with a sorted batch of inserts and a
+ * sorted set of deletions, without sorting anything again. The in-order
+ * walk of the old layout (nst_next) and the two sorted arrays are merged
+ * into one sorted stream, which nst_fill_stream writes straight into the
+ * new layout, the same in-order recursion as nst_build_sorted. Reads are
+ * sequential on all three inputs, each output node is written as a unit,
+ * and the only extra memory is the output and the recursion stack.
+ * An insert whose key is in the layout replaces its value, a deletion of a
+ * key that is not there is ignored, and a key that is both inserted and
+ * deleted ends up inserted. The size of the result is counted up front
+ * by nst_rebuild_size, with one search in the old layout per batch key,
+ * and handed to nst_rebuild by the caller, which sizes the output with it.
+ */
+
+// sorted stream of (layout - deletions - inserted keys) + inserts
+template<size_t n, class KeyTy, class ValueTy>
+class nst_merge_stream
+{
+public:
+	nst_merge_stream(const KeyTy* keys, const ValueTy* values, size_t size, const KeyTy* _insert_keys, const ValueTy* _insert_values, size_t _insert_size, const KeyTy* _erase_keys, size_t _erase_size)
+		: it{ nst_begin<n>(keys, values, size) }, end{ nst_end<n>(keys, values, size) },
+		insert_keys{ _insert_keys }, insert_values{ _insert_values }, insert_size{ _insert_size },
+		erase_keys{ _erase_keys }, erase_size{ _erase_size }
+	{
+	}
+
+	void next(KeyTy& key, ValueTy& value)
+	{
+		while (it != end && (b == insert_size || it.key() < insert_keys[b]))
+		{
+			while (e < erase_size && erase_keys[e] < it.key()) ++e;
+			const bool erased = e < erase_size && erase_keys[e] == it.key();
+			if (!erased)
+			{
+				key = it.key();
+				value = it.value();
+				++it;
+				return;
+			}
+			++it;
+		}
+		if (it != end && it.key() == insert_keys[b]) ++it;
+		key = insert_keys[b];
+		value = insert_values[b];
+		++b;
+	}
+
+private:
+	nst_iterator<n, KeyTy, ValueTy> it, end;
+	const KeyTy* insert_keys;
+	const ValueTy* insert_values;
+	size_t insert_size;
+	const KeyTy* erase_keys;
+	size_t erase_size;
+	size_t b = 0, e = 0;
+};
+
+// writes the subtree of the node starting at i, taking the pairs in order from stream.next(key, value)
+template<size_t n, class KeyTy, class ValueTy, class Stream>
+void nst_fill_stream(Stream& stream, size_t size, size_t i, KeyTy* out_keys, ValueTy* out_values)
+{
+	const size_t ke = std::min(n - 1, size - i);
+	for (size_t k = 0; k <= ke; ++k)
+	{
+		const size_t c = i * n + (n - 1) * (k + 1);
+		if (c < size) nst_fill_stream<n>(stream, size, c, out_keys, out_values);
+		if (k < ke) stream.next(out_keys[i + k], out_values[i + k]);
+	}
+}
+
+// number of keys after nst_rebuild with the same arguments
+template<size_t n, class KeyTy>
+size_t nst_rebuild_size(const KeyTy* keys, size_t size, const KeyTy* insert_keys, size_t insert_size, const KeyTy* erase_keys, size_t erase_size)
+{
+	size_t ret = size + insert_size, idx;
+	for (size_t j = 0; j < insert_size; ++j) ret -= nst_search<n>(keys, size, insert_keys[j], idx);
+	for (size_t j = 0; j < erase_size; ++j)
+	{
+		if (nst_search<n>(keys, size, erase_keys[j], idx) && !std::binary_search(insert_keys, insert_keys + insert_size, erase_keys[j])) --ret;
+	}
+	return ret;
+}
+
+/*
+ * Writes the layout of keys / values with the sorted batch insert_keys /
+ * insert_values merged in and the sorted erase_keys taken out to out_keys /
+ * out_values, which must not overlap the inputs. out_size is the size
+ * nst_rebuild_size returns for the same arguments, which callers need
+ * anyway to allocate the output.
+ */
+template<size_t n, class KeyTy, class ValueTy>
+void nst_rebuild(const KeyTy* keys, const ValueTy* values, size_t size, const KeyTy* insert_keys, const ValueTy* insert_values, size_t insert_size, const KeyTy* erase_keys, size_t erase_size, size_t out_size, KeyTy* out_keys, ValueTy* out_values)
+{
+	nst_merge_stream<n, KeyTy, ValueTy> stream{ keys, values, size, insert_keys, insert_values, insert_size, erase_keys, erase_size };
+	if (out_size) nst_fill_stream<n>(stream, out_size, 0, out_keys, out_values);
+}
+
+// the layout with a sorted batch of new keys merged in, out_keys / out_values hold up to size + batch_size pairs
+template<size_t n, class KeyTy, class ValueTy>
+size_t nst_merge_build(const KeyTy* keys, const ValueTy* values, size_t size, const KeyTy* batch_keys, const ValueTy* batch_values, size_t batch_size, KeyTy* out_keys, ValueTy* out_values)
+{
+	const size_t out_size = nst_rebuild_size<n>(keys, size, batch_keys, batch_size, (const KeyTy*)nullptr, 0);
+	nst_rebuild<n>(keys, values, size, batch_keys, batch_values, batch_size, (const KeyTy*)nullptr, 0, out_size, out_keys, out_values);
+	return out_size;
+}
+
+// the layout without the sorted erase_keys, out_keys / out_values hold up to size pairs
+template<size_t n, class KeyTy, class ValueTy>
+size_t nst_erase_build(const KeyTy* keys, const ValueTy* values, size_t size, const KeyTy* erase_keys, size_t erase_size, KeyTy* out_keys, ValueTy* out_values)
+{
+	const size_t out_size = nst_rebuild_size<n>(keys, size, (const KeyTy*)nullptr, 0, erase_keys, erase_size);
+	nst_rebuild<n>(keys, values, size, (const KeyTy*)nullptr, (const ValueTy*)nullptr, 0, erase_keys, erase_size, out_size, out_keys, out_values);
+	return out_size;
+}
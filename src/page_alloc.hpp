@@ -0,0 +1,209 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <new>
+#include <vector>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#if defined(__APPLE__)
+#include <sys/sysctl.h>
+#endif
+#endif
+
+#if defined(__linux__) && !defined(MAP_HUGE_SHIFT)
+#define MAP_HUGE_SHIFT 26
+#endif
+
+/*
+ * Page-backed allocation for the key and value arrays. Large layouts are
+ * bound by dTLB misses rather than cache misses, so the page size the arrays
+ * are mapped with decides the cost of a lookup as much as the layout does.
+ * small maps 4 KiB pages with transparent huge pages disabled,
+ * transparent_huge asks for them with MADV_HUGEPAGE, and huge_2m / huge_1g
+ * take explicit hugetlbfs pages, which have to be reserved beforehand
+ * (vm.nr_hugepages or the hugepages-1048576kB pool). Only small is
+ * supported outside Linux.
+ */
+
+enum class page_kind
+{
+	small,
+	transparent_huge,
+	huge_2m,
+	huge_1g,
+};
+
+inline const char* page_kind_name(page_kind kind)
+{
+	switch (kind)
+	{
+	case page_kind::transparent_huge:
+		return "THP";
+	case page_kind::huge_2m:
+		return "2MiB hugetlb";
+	case page_kind::huge_1g:
+		return "1GiB hugetlb";
+	default:
+		return "4KiB";
+	}
+}
+
+inline size_t page_bytes(page_kind kind)
+{
+	switch (kind)
+	{
+	case page_kind::transparent_huge:
+	case page_kind::huge_2m:
+		return (size_t)2 << 20;
+	case page_kind::huge_1g:
+		return (size_t)1 << 30;
+	default:
+		return 4096;
+	}
+}
+
+// the kind used by page_allocator and aligned_buffer when none is given
+inline page_kind& default_page_kind()
+{
+	static page_kind kind = page_kind::small;
+	return kind;
+}
+
+inline size_t page_round_up(size_t bytes, page_kind kind)
+{
+	const size_t p = page_bytes(kind);
+	return (bytes + p - 1) / p * p;
+}
+
+// returns nullptr if the pages cannot be mapped
+inline void* try_page_alloc(size_t bytes, page_kind kind)
+{
+	if (!bytes) bytes = 1;
+	bytes = page_round_up(bytes, kind);
+#if defined(_WIN32)
+	if (kind != page_kind::small) return nullptr;
+	return VirtualAlloc(nullptr, bytes, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+	int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#if defined(__linux__)
+	if (kind == page_kind::huge_2m) flags |= MAP_HUGETLB | (21 << MAP_HUGE_SHIFT);
+	if (kind == page_kind::huge_1g) flags |= MAP_HUGETLB | (30 << MAP_HUGE_SHIFT);
+#else
+	if (kind != page_kind::small) return nullptr;
+#endif
+	void* p = mmap(nullptr, bytes, PROT_READ | PROT_WRITE, flags, -1, 0);
+	if (p == MAP_FAILED) return nullptr;
+#if defined(__linux__)
+	if (kind == page_kind::small) madvise(p, bytes, MADV_NOHUGEPAGE);
+	if (kind == page_kind::transparent_huge && madvise(p, bytes, MADV_HUGEPAGE))
+	{
+		munmap(p, bytes);
+		return nullptr;
+	}
+#endif
+	return p;
+#endif
+}
+
+inline void* page_alloc(size_t bytes, page_kind kind)
+{
+	void* p = try_page_alloc(bytes, kind);
+	if (!p) throw std::bad_alloc{};
+	return p;
+}
+
+inline void page_free(void* p, size_t bytes, page_kind kind)
+{
+	if (!p) return;
+#if defined(_WIN32)
+	VirtualFree(p, 0, MEM_RELEASE);
+#else
+	if (!bytes) bytes = 1;
+	munmap(p, page_round_up(bytes, kind));
+#endif
+}
+
+// true if pages of the kind can be mapped right now
+inline bool page_kind_available(page_kind kind)
+{
+	const size_t bytes = page_bytes(kind);
+	void* p = try_page_alloc(bytes, kind);
+	if (!p) return false;
+	page_free(p, bytes, kind);
+	return true;
+}
+
+// physical memory that can be allocated without swapping, 0 if unknown
+inline size_t available_memory()
+{
+#if defined(_WIN32)
+	MEMORYSTATUSEX status;
+	status.dwLength = sizeof(status);
+	if (!GlobalMemoryStatusEx(&status)) return 0;
+	return (size_t)status.ullAvailPhys;
+#elif defined(__linux__)
+	FILE* f = fopen("/proc/meminfo", "r");
+	if (!f) return 0;
+	char line[256];
+	size_t kb = 0;
+	while (fgets(line, sizeof(line), f))
+	{
+		if (sscanf(line, "MemAvailable: %zu kB", &kb) == 1) break;
+	}
+	fclose(f);
+	return kb * 1024;
+#elif defined(__APPLE__)
+	uint64_t total = 0;
+	size_t len = sizeof(total);
+	if (sysctlbyname("hw.memsize", &total, &len, nullptr, 0)) return 0;
+	// there is no cheap equivalent of MemAvailable, so keep half for the rest of the system
+	return (size_t)(total / 2);
+#else
+	return 0;
+#endif
+}
+
+// stateful allocator, the kind is fixed when the allocator is created
+template<class Ty>
+struct page_allocator
+{
+	using value_type = Ty;
+
+	page_kind kind;
+
+	page_allocator(page_kind _kind = default_page_kind()) : kind{ _kind }
+	{
+	}
+
+	template<class OTy>
+	page_allocator(const page_allocator<OTy>& o) : kind{ o.kind }
+	{
+	}
+
+	Ty* allocate(size_t n)
+	{
+		return (Ty*)page_alloc(n * sizeof(Ty), kind);
+	}
+
+	void deallocate(Ty* p, size_t n)
+	{
+		page_free(p, n * sizeof(Ty), kind);
+	}
+
+	template<class OTy>
+	bool operator==(const page_allocator<OTy>& o) const { return kind == o.kind; }
+
+	template<class OTy>
+	bool operator!=(const page_allocator<OTy>& o) const { return kind != o.kind; }
+};
+
+template<class Ty>
+using page_vector = std::vector<Ty, page_allocator<Ty>>;
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+/*
+ * Minimal fork-join helpers for the builders. The calling thread takes part
+ * in the work, so a single thread never spawns anything.
+ */
+
+inline size_t default_threads()
+{
+	return std::max((size_t)std::thread::hardware_concurrency(), (size_t)1);
+}
+
+// calls fn(task) for every task in [0, num_tasks), threads take the next task as they finish one
+template<class Fn>
+void parallel_tasks(size_t num_tasks, size_t num_threads, Fn&& fn)
+{
+	num_threads = std::max(std::min(num_threads, num_tasks), (size_t)1);
+	std::atomic<size_t> next{ 0 };
+	auto worker = [&]()
+	{
+		for (size_t t; (t = next.fetch_add(1, std::memory_order_relaxed)) < num_tasks;) fn(t);
+	};
+
+	std::vector<std::thread> threads;
+	for (size_t i = 1; i < num_threads; ++i) threads.emplace_back(worker);
+	worker();
+	for (auto& t : threads) t.join();
+}
+
+// calls fn(first, last) on num_threads contiguous slices of [0, size)
+template<class Fn>
+void parallel_for(size_t size, size_t num_threads, Fn&& fn)
+{
+	num_threads = std::max(std::min(num_threads, size), (size_t)1);
+	parallel_tasks(num_threads, num_threads, [&](size_t t)
+	{
+		fn(size * t / num_threads, size * (t + 1) / num_threads);
+	});
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <cstdint>
+#include <algorithm>
+#include <vector>
+#include <type_traits>
+
+#include "balanced_binary.hpp"
+
+/*
+ * Jump table over sorted keys, indexed by the high bits of the key within
+ * the key range: entry p is the first position whose key has prefix p or
+ * more, so the keys with prefix p are [offsets[p], offsets[p + 1]). It
+ * replaces the top levels of a search with one load from a table that
+ * stays in the L2 cache. build() sizes it from the keys: one entry per
+ * keys_per_entry keys, no more entries than the range has values (a dense
+ * id space then maps every key to its own entry), and at most 2^max_bits
+ * entries. Keys are compared as unsigned with the sign bit flipped, like
+ * radix_sort_pairs, so signed and order-transformed keys work alike.
+ */
+class radix_directory
+{
+public:
+	static constexpr size_t max_bits = 16;
+	static constexpr size_t keys_per_entry = 8;
+
+	// keys must be sorted, size below 2^32
+	template<class KeyTy>
+	void build(const KeyTy* keys, size_t size)
+	{
+		offsets.assign(2, 0);
+		shift = 0;
+		if (!size) return;
+
+		lo = radix_key(keys[0]);
+		hi = radix_key(keys[size - 1]);
+		size_t range_bits = 0;
+		while (range_bits < 64 && ((hi - lo) >> range_bits)) ++range_bits;
+		size_t bits = 0;
+		while (bits < max_bits && ((size_t)keys_per_entry << bits) < size) ++bits;
+		bits = std::min(bits, range_bits);
+		shift = range_bits - bits;
+
+		offsets.assign(((size_t)1 << bits) + 1, (uint32_t)size);
+		size_t p = 0;
+		for (size_t i = 0; i < size; ++i)
+		{
+			const size_t prefix = prefix_of(radix_key(keys[i]));
+			while (p <= prefix) offsets[p++] = (uint32_t)i;
+		}
+	}
+
+	// positions [first, last) that hold target if it is present, empty if it is out of range
+	template<class KeyTy>
+	void window(KeyTy target, size_t& first, size_t& last) const
+	{
+		const uint64_t u = radix_key(target);
+		if (u < lo || u > hi)
+		{
+			first = last = 0;
+			return;
+		}
+		const size_t prefix = prefix_of(u);
+		first = offsets[prefix];
+		last = offsets[prefix + 1];
+	}
+
+	size_t entries() const { return offsets.size() - 1; }
+
+private:
+	std::vector<uint32_t> offsets;
+	uint64_t lo = 0, hi = 0;
+	size_t shift = 0;
+
+	// a single entry over a 64-bit range has shift 64, which cannot be shifted by
+	size_t prefix_of(uint64_t u) const
+	{
+		return shift < 64 ? (size_t)((u - lo) >> shift) : 0;
+	}
+
+	template<class KeyTy>
+	static uint64_t radix_key(KeyTy key)
+	{
+		using UTy = typename std::make_unsigned<KeyTy>::type;
+		UTy u = (UTy)key;
+		if (std::is_signed<KeyTy>::value) u ^= (UTy)((UTy)1 << (sizeof(KeyTy) * 8 - 1));
+		return (uint64_t)u;
+	}
+};
+
+template<class IntTy>
+bool radix_search(const radix_directory& directory, const IntTy* keys, size_t size, IntTy target, size_t& ret)
+{
+	if (!size) return false;
+	size_t lo, hi;
+	directory.window(target, lo, hi);
+	if (lo == hi || !balanced_binary_search<false>(keys + lo, hi - lo, target, ret)) return false;
+	ret += lo;
+	return true;
+}
+
+#ifdef AVX2_KERNELS_AVAILABLE
+template<class IntTy>
+TARGET_AVX2 bool radix_search_avx2(const radix_directory& directory, const IntTy* keys, size_t size, IntTy target, size_t& ret)
+{
+	if (!size) return false;
+	size_t lo, hi;
+	directory.window(target, lo, hi);
+	if (lo == hi || !balanced_binary_search_avx2<false>(keys + lo, hi - lo, target, ret)) return false;
+	ret += lo;
+	return true;
+}
+#endif
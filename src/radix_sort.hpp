@@ -0,0 +1,231 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <numeric>
+#include <cstdint>
+#include <type_traits>
+#include <cstring>
+
+#include "page_alloc.hpp"
+
+#if defined(__SSE2__) || defined(__AVX2__)
+#include <emmintrin.h>
+#endif
+
+/*
+ * LSD radix sort of (key, value) pairs for integer keys. Keys of 1 or 2
+ * bytes use 8-bit digits, wider keys 11-bit digits (3 passes for 32-bit
+ * keys, 6 for 64-bit ones). One read of the keys builds the histograms of
+ * every pass, and a pass is skipped when all keys share its digit. Input
+ * that is already sorted returns after a single comparison pass.
+ * The scatter stages one cache line of keys per bucket and writes it out
+ * with non-temporal stores (software write combining), so the destination
+ * is never read for ownership and the 2^11 partially written lines do not
+ * compete for the cache. A bucket's staging line mirrors the destination
+ * line its keys go to, so the first flush only fills up to the next line
+ * boundary of the destination keys and every later flush writes one whole,
+ * aligned line. Plain stores from the staging buffers were
+ * slower than scattering directly.
+ */
+
+// digit of key at shift, with the sign bit flipped so that signed keys sort in order
+template<class KeyTy>
+inline size_t radix_digit(KeyTy key, size_t shift, size_t mask)
+{
+	using UTy = typename std::make_unsigned<KeyTy>::type;
+	UTy u = (UTy)key;
+	if (std::is_signed<KeyTy>::value) u ^= (UTy)((UTy)1 << (sizeof(KeyTy) * 8 - 1));
+	return (size_t)(u >> shift) & mask;
+}
+
+// copies past the caches where the type fits a movnti, radix_scatter fences before the next pass reads dst
+template<class Ty>
+inline void stream_copy(const Ty* src, size_t count, Ty* dst)
+{
+#if defined(__SSE2__) || defined(__AVX2__)
+	if (std::is_trivially_copyable<Ty>::value && sizeof(Ty) == 4)
+	{
+		for (size_t j = 0; j < count; ++j)
+		{
+			int v;
+			std::memcpy(&v, &src[j], 4);
+			_mm_stream_si32((int*)&dst[j], v);
+		}
+		return;
+	}
+#if defined(_M_X64) || defined(__x86_64__)
+	if (std::is_trivially_copyable<Ty>::value && sizeof(Ty) == 8)
+	{
+		for (size_t j = 0; j < count; ++j)
+		{
+			long long v;
+			std::memcpy(&v, &src[j], 8);
+			_mm_stream_si64((long long*)&dst[j], v);
+		}
+		return;
+	}
+#endif
+#endif
+	std::copy(src, src + count, dst);
+}
+
+// offsets holds the first destination of every bucket and is advanced past it
+template<size_t digit_bits, class KeyTy, class ValueTy>
+void radix_scatter(const KeyTy* src_keys, const ValueTy* src_values, KeyTy* dst_keys, ValueTy* dst_values, size_t size, size_t shift, size_t* offsets)
+{
+	static constexpr size_t buckets = (size_t)1 << digit_bits;
+	static constexpr size_t line = 64 / sizeof(KeyTy);
+
+	std::vector<KeyTy> key_buf(buckets * line);
+	std::vector<ValueTy> value_buf(buckets * line);
+	std::vector<uint8_t> fill(buckets);
+	// the staging line of a bucket mirrors the destination line, the first one starts at the misalignment head[d]
+	std::vector<uint8_t> head(buckets);
+	for (size_t d = 0; d < buckets; ++d)
+	{
+		head[d] = fill[d] = (uint8_t)(((uintptr_t)(dst_keys + offsets[d]) / sizeof(KeyTy)) % line);
+		offsets[d] -= head[d];
+	}
+
+	for (size_t i = 0; i < size; ++i)
+	{
+		const size_t d = radix_digit(src_keys[i], shift, buckets - 1);
+		size_t f = fill[d];
+		key_buf[d * line + f] = src_keys[i];
+		value_buf[d * line + f] = src_values[i];
+		if (++f == line)
+		{
+			if (head[d])
+			{
+				const size_t first = head[d];
+				stream_copy(&key_buf[d * line + first], line - first, dst_keys + (offsets[d] + first));
+				stream_copy(&value_buf[d * line + first], line - first, dst_values + (offsets[d] + first));
+				head[d] = 0;
+			}
+			else
+			{
+				stream_copy(&key_buf[d * line], line, dst_keys + offsets[d]);
+				stream_copy(&value_buf[d * line], line, dst_values + offsets[d]);
+			}
+			offsets[d] += line;
+			f = 0;
+		}
+		fill[d] = (uint8_t)f;
+	}
+
+	for (size_t d = 0; d < buckets; ++d)
+	{
+		const size_t first = head[d];
+		std::copy(&key_buf[d * line + first], &key_buf[d * line] + fill[d], dst_keys + (offsets[d] + first));
+		std::copy(&value_buf[d * line + first], &value_buf[d * line] + fill[d], dst_values + (offsets[d] + first));
+		offsets[d] += fill[d];
+	}
+#if defined(__SSE2__) || defined(__AVX2__)
+	_mm_sfence();
+#endif
+}
+
+template<class KeyTy, class ValueTy>
+void radix_sort_pairs(KeyTy* keys, ValueTy* values, size_t size)
+{
+	static_assert(std::is_integral<KeyTy>::value, "radix_sort_pairs needs integer keys");
+	static constexpr size_t digit_bits = sizeof(KeyTy) <= 2 ? 8 : 11;
+	static constexpr size_t buckets = (size_t)1 << digit_bits;
+	static constexpr size_t passes = (sizeof(KeyTy) * 8 + digit_bits - 1) / digit_bits;
+
+	if (std::is_sorted(keys, keys + size)) return;
+
+	std::vector<size_t> hist(passes * buckets);
+	for (size_t i = 0; i < size; ++i)
+	{
+		for (size_t p = 0; p < passes; ++p) ++hist[p * buckets + radix_digit(keys[i], p * digit_bits, buckets - 1)];
+	}
+
+	page_vector<KeyTy> temp_keys(size);
+	page_vector<ValueTy> temp_values(size);
+	KeyTy* src_keys = keys, * dst_keys = temp_keys.data();
+	ValueTy* src_values = values, * dst_values = temp_values.data();
+	for (size_t p = 0; p < passes; ++p)
+	{
+		size_t* offsets = &hist[p * buckets];
+		if (offsets[radix_digit(src_keys[0], p * digit_bits, buckets - 1)] == size) continue;
+
+		for (size_t d = 0, sum = 0; d < buckets; ++d)
+		{
+			const size_t c = offsets[d];
+			offsets[d] = sum;
+			sum += c;
+		}
+		radix_scatter<digit_bits>(src_keys, src_values, dst_keys, dst_values, size, p * digit_bits, offsets);
+		std::swap(src_keys, dst_keys);
+		std::swap(src_values, dst_values);
+	}
+
+	if (src_keys != keys)
+	{
+		std::copy(src_keys, src_keys + size, keys);
+		std::copy(src_values, src_values + size, values);
+	}
+}
+
+// comparison sort through an index, for key types without a radix path and for small inputs
+template<class KeyTy, class ValueTy>
+void sort_pairs_indirect(KeyTy* keys, ValueTy* values, size_t size)
+{
+	page_vector<size_t> idx(size);
+	std::iota(idx.begin(), idx.end(), 0);
+
+	std::sort(idx.begin(), idx.end(), [&](size_t a, size_t b)
+	{
+		return keys[a] < keys[b];
+	});
+
+	page_vector<KeyTy> temp_keys{ keys, keys + size };
+	page_vector<ValueTy> temp_values{ values, values + size };
+
+	for (size_t i = 0; i < size; ++i)
+	{
+		keys[i] = temp_keys[idx[i]];
+		values[i] = temp_values[idx[i]];
+	}
+}
+
+// sorts keys and moves values along with them
+template<class KeyTy, class ValueTy>
+typename std::enable_if<std::is_integral<KeyTy>::value>::type sort_pairs(KeyTy* keys, ValueTy* values, size_t size)
+{
+	static constexpr size_t min_radix_size = 4096;
+	if (size < min_radix_size) sort_pairs_indirect(keys, values, size);
+	else radix_sort_pairs(keys, values, size);
+}
+
+template<class KeyTy, class ValueTy>
+typename std::enable_if<!std::is_integral<KeyTy>::value>::type sort_pairs(KeyTy* keys, ValueTy* values, size_t size)
+{
+	sort_pairs_indirect(keys, values, size);
+}
+
+// positions of the keys in sorted order
+template<class KeyTy>
+typename std::enable_if<std::is_integral<KeyTy>::value, std::vector<size_t>>::type sorted_index(const KeyTy* keys, size_t size)
+{
+	std::vector<size_t> idx(size);
+	std::iota(idx.begin(), idx.end(), 0);
+	std::vector<KeyTy> temp_keys{ keys, keys + size };
+	sort_pairs(temp_keys.data(), idx.data(), size);
+	return idx;
+}
+
+template<class KeyTy>
+typename std::enable_if<!std::is_integral<KeyTy>::value, std::vector<size_t>>::type sorted_index(const KeyTy* keys, size_t size)
+{
+	std::vector<size_t> idx(size);
+	std::iota(idx.begin(), idx.end(), 0);
+
+	std::sort(idx.begin(), idx.end(), [&](size_t a, size_t b)
+	{
+		return keys[a] < keys[b];
+	});
+	return idx;
+}
@@ -0,0 +1,181 @@
+#pragma once
+
+#include <cstdint>
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "dispatch.hpp"
+#include "nst_build.hpp"
+#include "page_alloc.hpp"
+
+/*
+ * Index handle that owns its arrays and publishes immutable snapshots of
+ * them through an atomic pointer, so a new layout can be built off to the
+ * side while readers keep searching the old one. Snapshots are reclaimed
+ * with epochs: a reader announces the global epoch in its own cache line
+ * when it enters and clears it when it leaves, and publish() retires the
+ * old snapshot with the epoch it advances to. A retired snapshot is freed
+ * once no reader is inside an earlier epoch. Entering costs one store and
+ * one fence, which a reader pays per batch of lookups rather than per
+ * lookup; inside, a lookup only follows the pointer enter() returned.
+ * The reader's store, fence, pointer load pairs with publish()'s pointer
+ * exchange, fence, slot loads: either the reader sees the new snapshot, or
+ * the writer sees the reader and keeps the old one.
+ * Writers serialize on a mutex, readers never block and never run an atomic
+ * read-modify-write outside register_reader().
+ */
+template<class Snapshot>
+class snapshot_index
+{
+	struct alignas(64) reader_slot
+	{
+		// epoch the reader entered in, 0 while it is outside
+		std::atomic<uint64_t> epoch{ 0 };
+		std::atomic<bool> claimed{ false };
+	};
+
+public:
+	static constexpr size_t max_readers = 256;
+
+	class reader
+	{
+	public:
+		reader(reader&& o) noexcept
+			: index{ o.index }, slot{ o.slot }
+		{
+			o.index = nullptr;
+		}
+
+		reader(const reader&) = delete;
+		reader& operator=(const reader&) = delete;
+		reader& operator=(reader&&) = delete;
+
+		~reader()
+		{
+			if (!index) return;
+			leave();
+			index->slots[slot].claimed.store(false, std::memory_order_release);
+		}
+
+		// the current snapshot, valid until leave()
+		const Snapshot* enter()
+		{
+			reader_slot& s = index->slots[slot];
+			s.epoch.store(index->epoch.load(std::memory_order_acquire), std::memory_order_relaxed);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			return index->current.load(std::memory_order_acquire);
+		}
+
+		void leave()
+		{
+			index->slots[slot].epoch.store(0, std::memory_order_release);
+		}
+
+	private:
+		friend class snapshot_index;
+
+		snapshot_index* index;
+		size_t slot;
+
+		reader(snapshot_index* _index, size_t _slot)
+			: index{ _index }, slot{ _slot }
+		{
+		}
+	};
+
+	snapshot_index() = default;
+	snapshot_index(const snapshot_index&) = delete;
+	snapshot_index& operator=(const snapshot_index&) = delete;
+
+	// readers must be gone
+	~snapshot_index()
+	{
+		delete current.load(std::memory_order_relaxed);
+	}
+
+	reader register_reader()
+	{
+		for (size_t i = 0; i < max_readers; ++i)
+		{
+			bool expected = false;
+			if (!slots[i].claimed.load(std::memory_order_relaxed) && slots[i].claimed.compare_exchange_strong(expected, true, std::memory_order_acquire)) return reader{ this, i };
+		}
+		throw std::runtime_error("snapshot_index: all reader slots are taken");
+	}
+
+	// makes next the current snapshot and frees the retired ones no reader can still see
+	void publish(std::unique_ptr<Snapshot> next)
+	{
+		std::lock_guard<std::mutex> lock{ writer_mutex };
+		const Snapshot* old = current.exchange(next.release(), std::memory_order_seq_cst);
+		const uint64_t retire_epoch = epoch.fetch_add(1, std::memory_order_seq_cst) + 1;
+		if (old) retired.emplace_back(retire_epoch, std::unique_ptr<const Snapshot>{ old });
+		reclaim_locked();
+	}
+
+	// frees what it can, returns the number of snapshots still retired
+	size_t reclaim()
+	{
+		std::lock_guard<std::mutex> lock{ writer_mutex };
+		return reclaim_locked();
+	}
+
+	// waits until every retired snapshot is freed, the caller must not be inside a reader
+	void synchronize()
+	{
+		while (reclaim()) std::this_thread::yield();
+	}
+
+private:
+	std::atomic<const Snapshot*> current{ nullptr };
+	std::atomic<uint64_t> epoch{ 1 };
+	reader_slot slots[max_readers];
+
+	std::mutex writer_mutex;
+	std::vector<std::pair<uint64_t, std::unique_ptr<const Snapshot>>> retired;
+
+	size_t reclaim_locked()
+	{
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		uint64_t oldest = std::numeric_limits<uint64_t>::max();
+		for (const reader_slot& s : slots)
+		{
+			const uint64_t e = s.epoch.load(std::memory_order_acquire);
+			if (e) oldest = std::min(oldest, e);
+		}
+		retired.erase(std::remove_if(retired.begin(), retired.end(), [&](const std::pair<uint64_t, std::unique_ptr<const Snapshot>>& r)
+		{
+			return r.first <= oldest;
+		}), retired.end());
+		return retired.size();
+	}
+};
+
+// immutable nst_order<n> layout over a copy of the keys and values
+template<size_t n, class KeyTy, class ValueTy>
+struct nst_snapshot
+{
+	page_vector<KeyTy> keys;
+	page_vector<ValueTy> values;
+
+	nst_snapshot(const KeyTy* _keys, const ValueTy* _values, size_t size)
+		: keys(_keys, _keys + size), values(_values, _values + size)
+	{
+		nst_arrange<n>(keys.data(), values.data(), size);
+	}
+
+	bool search(KeyTy target, ValueTy& found) const
+	{
+		size_t idx;
+		if (keys.empty() || !nst_search_dispatched<n, KeyTy>(keys.data(), keys.size(), target, idx)) return false;
+		found = values[idx];
+		return true;
+	}
+};
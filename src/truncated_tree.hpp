@@ -0,0 +1,230 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+#include "bst.hpp"
+#include "aligned_buffer.hpp"
+
+/*
+ * Static B+-tree over sorted keys whose inner nodes store truncated
+ * separators. The leaves are the sorted key array itself, cut into 64-byte
+ * blocks. An inner node is one 64-byte line: the smallest key of its
+ * subtree (lo) in its last sizeof(KeyTy) bytes, a shift in the byte before
+ * it, and in front of them one separator per child but the first, the
+ * smallest key of that child as min((key - lo) >> shift, max of SepTy).
+ * The shift is the smallest one that makes the range of the node fit, so
+ * the separators keep the highest bits that differ within the node. With
+ * 16-bit separators a node has 30 children for int32 keys (17 for full
+ * keys), with 8-bit ones 60, which keeps the upper levels of a tree over
+ * 10^8 keys within the L1 and L2 caches.
+ * Truncation keeps the order but not the distinctness of the separators.
+ * A target whose truncated value equals one or more separators is resolved
+ * with the full separators, kept in a parallel array that the search only
+ * reads in that case. As in the FOR tree, the separators are stored with
+ * the sign bit flipped for the signed SIMD compares.
+ */
+struct truncated_tree
+{
+	aligned_buffer nodes;
+	aligned_buffer separators;
+	// first node of every inner level from the root down, and the node count
+	std::vector<size_t> level_start;
+	size_t leaves = 0;
+
+	size_t levels() const { return level_start.size() - 1; }
+
+	// nodes on level l, leaves below the last inner level
+	size_t level_size(size_t l) const { return l < levels() ? level_start[l + 1] - level_start[l] : leaves; }
+};
+
+template<class KeyTy, class SepTy>
+constexpr size_t truncated_separators()
+{
+	return (64 - sizeof(KeyTy) - 1) / sizeof(SepTy);
+}
+
+template<class KeyTy, class SepTy>
+constexpr size_t truncated_fanout()
+{
+	return truncated_separators<KeyTy, SepTy>() + 1;
+}
+
+template<class KeyTy>
+constexpr size_t truncated_leaf_keys()
+{
+	return 64 / sizeof(KeyTy);
+}
+
+// min((key - lo) >> shift, max of SepTy) with the sign bit flipped, 0 before flipping for keys below lo
+template<class SepTy, class KeyTy>
+inline SepTy truncate_key(KeyTy key, KeyTy lo, size_t shift)
+{
+	using UTy = typename std::make_unsigned<KeyTy>::type;
+	using USepTy = typename std::make_unsigned<SepTy>::type;
+	static constexpr USepTy sign = (USepTy)1 << (sizeof(SepTy) * 8 - 1);
+	USepTy t = 0;
+	if (key >= lo) t = (USepTy)std::min<UTy>(((UTy)key - (UTy)lo) >> shift, std::numeric_limits<USepTy>::max());
+	return (SepTy)(USepTy)(t ^ sign);
+}
+
+// keys must be sorted
+template<class SepTy, class KeyTy>
+void truncated_tree_build(truncated_tree& tree, const KeyTy* keys, size_t size)
+{
+	using UTy = typename std::make_unsigned<KeyTy>::type;
+	using USepTy = typename std::make_unsigned<SepTy>::type;
+	static constexpr size_t seps = truncated_separators<KeyTy, SepTy>();
+	static constexpr size_t fanout = truncated_fanout<KeyTy, SepTy>();
+	static constexpr size_t leaf_keys = truncated_leaf_keys<KeyTy>();
+
+	tree.leaves = (size + leaf_keys - 1) / leaf_keys;
+	std::vector<size_t> sizes;
+	for (size_t count = tree.leaves; count > 1;) sizes.push_back(count = (count + fanout - 1) / fanout);
+	std::reverse(sizes.begin(), sizes.end());
+	tree.level_start.assign(1, 0);
+	for (size_t count : sizes) tree.level_start.push_back(tree.level_start.back() + count);
+
+	const size_t nodes = tree.level_start.back();
+	tree.nodes.allocate(nodes * 64);
+	tree.separators.allocate(nodes * seps * sizeof(KeyTy));
+	KeyTy* full = tree.separators.data<KeyTy>();
+
+	// keys below a child of a node on level l, filled from the bottom up
+	size_t child_keys = leaf_keys;
+	for (size_t l = tree.levels(); l-- > 0; child_keys *= fanout)
+	{
+		for (size_t j = 0; j < tree.level_size(l); ++j)
+		{
+			const size_t m = tree.level_start[l] + j;
+			uint8_t* node = tree.nodes.data<uint8_t>() + m * 64;
+			const size_t first = j * fanout * child_keys;
+			const KeyTy lo = keys[first];
+			const KeyTy hi = keys[std::min(first + fanout * child_keys, size) - 1];
+			uint8_t shift = 0;
+			while ((((UTy)hi - (UTy)lo) >> shift) > std::numeric_limits<USepTy>::max()) ++shift;
+
+			SepTy* lanes = (SepTy*)node;
+			for (size_t k = 0; k < seps; ++k)
+			{
+				const size_t child_first = first + (k + 1) * child_keys;
+				const KeyTy sep = child_first < size ? keys[child_first] : std::numeric_limits<KeyTy>::max();
+				lanes[k] = child_first < size ? truncate_key<SepTy>(sep, lo, shift) : std::numeric_limits<SepTy>::max();
+				full[m * seps + k] = sep;
+			}
+			node[64 - sizeof(KeyTy) - 1] = shift;
+			std::memcpy(node + 64 - sizeof(KeyTy), &lo, sizeof(KeyTy));
+		}
+	}
+}
+
+template<class KeyTy>
+inline bool truncated_leaf_search(const KeyTy* keys, size_t size, size_t leaf, KeyTy target, size_t& ret)
+{
+	const size_t first = leaf * truncated_leaf_keys<KeyTy>();
+	const size_t count = std::min(truncated_leaf_keys<KeyTy>(), size - first);
+	size_t r = 0;
+	for (size_t k = 0; k < count; ++k) r += keys[first + k] < target;
+	if (r < count && keys[first + r] == target)
+	{
+		ret = first + r;
+		return true;
+	}
+	return false;
+}
+
+// child of node m given lt / le, the numbers of separators below / not above the truncated target
+template<class KeyTy, class SepTy>
+inline size_t truncated_child(const truncated_tree& tree, size_t l, size_t j, size_t lt, size_t le, KeyTy target)
+{
+	static constexpr size_t seps = truncated_separators<KeyTy, SepTy>();
+	static constexpr size_t fanout = truncated_fanout<KeyTy, SepTy>();
+
+	size_t c = lt;
+	if (lt != le)
+	{
+		const KeyTy* full = tree.separators.data<KeyTy>() + (tree.level_start[l] + j) * seps;
+		for (size_t k = lt; k < le; ++k) c += full[k] <= target;
+	}
+	const size_t children = std::min(fanout, tree.level_size(l + 1) - j * fanout);
+	return j * fanout + std::min(c, children - 1);
+}
+
+// keys is the sorted array the tree was built from, ret its index of target
+template<class SepTy, class KeyTy>
+bool truncated_tree_search(const truncated_tree& tree, const KeyTy* keys, size_t size, KeyTy target, size_t& ret)
+{
+	static constexpr size_t seps = truncated_separators<KeyTy, SepTy>();
+
+	if (!size) return false;
+	size_t j = 0;
+	for (size_t l = 0; l < tree.levels(); ++l)
+	{
+		const uint8_t* node = tree.nodes.data<uint8_t>() + (tree.level_start[l] + j) * 64;
+		const SepTy* lanes = (const SepTy*)node;
+		KeyTy lo;
+		std::memcpy(&lo, node + 64 - sizeof(KeyTy), sizeof(KeyTy));
+		const SepTy t = truncate_key<SepTy>(target, lo, node[64 - sizeof(KeyTy) - 1]);
+
+		size_t lt = 0, le = 0;
+		for (size_t k = 0; k < seps; ++k)
+		{
+			lt += lanes[k] < t;
+			le += lanes[k] <= t;
+		}
+		j = truncated_child<KeyTy, SepTy>(tree, l, j, lt, le, target);
+	}
+	return truncated_leaf_search(keys, size, j, target, ret);
+}
+
+#ifdef AVX2_KERNELS_AVAILABLE
+template<class SepTy, class KeyTy>
+TARGET_AVX2 bool truncated_tree_search_avx2(const truncated_tree& tree, const KeyTy* keys, size_t size, KeyTy target, size_t& ret)
+{
+	static constexpr size_t seps = truncated_separators<KeyTy, SepTy>();
+	static constexpr size_t leaf_keys = truncated_leaf_keys<KeyTy>();
+	// movemask bits of the separator lanes in the upper half of a node
+	static constexpr uint32_t sep_mask = (uint32_t)(((uint64_t)1 << (seps * sizeof(SepTy) - 32)) - 1);
+
+	if (!size) return false;
+	size_t j = 0;
+	for (size_t l = 0; l < tree.levels(); ++l)
+	{
+		const uint8_t* node = tree.nodes.data<uint8_t>() + (tree.level_start[l] + j) * 64;
+		KeyTy lo;
+		std::memcpy(&lo, node + 64 - sizeof(KeyTy), sizeof(KeyTy));
+		const __m256i pt = set1_avx2(truncate_key<SepTy>(target, lo, node[64 - sizeof(KeyTy) - 1]));
+		__m256i plo = _mm256_load_si256((const __m256i*)node);
+		__m256i phi = _mm256_load_si256((const __m256i*)(node + 32));
+
+		const size_t lt = (popcount(_mm256_movemask_epi8(cmpgt_avx2<SepTy>(pt, plo)))
+			+ popcount((uint32_t)_mm256_movemask_epi8(cmpgt_avx2<SepTy>(pt, phi)) & sep_mask)) / sizeof(SepTy);
+		const size_t gt = (popcount(_mm256_movemask_epi8(cmpgt_avx2<SepTy>(plo, pt)))
+			+ popcount((uint32_t)_mm256_movemask_epi8(cmpgt_avx2<SepTy>(phi, pt)) & sep_mask)) / sizeof(SepTy);
+		j = truncated_child<KeyTy, SepTy>(tree, l, j, lt, seps - gt, target);
+	}
+
+	const size_t first = j * leaf_keys;
+	if (first + leaf_keys > size) return truncated_leaf_search(keys, size, j, target, ret);
+
+	static constexpr size_t packet_size = 32 / sizeof(KeyTy);
+	const __m256i ptarget = set1_avx2(target);
+	size_t c = 0;
+	for (size_t p = 0; p < leaf_keys / packet_size; ++p)
+	{
+		__m256i pkey = _mm256_loadu_si256((const __m256i*)&keys[first + p * packet_size]);
+		c += popcount(_mm256_movemask_epi8(cmpgt_avx2<KeyTy>(ptarget, pkey)));
+	}
+	const size_t r = c / sizeof(KeyTy);
+	if (r < leaf_keys && keys[first + r] == target)
+	{
+		ret = first + r;
+		return true;
+	}
+	return false;
+}
+#endif